@@ -0,0 +1,99 @@
+#include <QQmlEngine>
+#include "qfactionenvelope.h"
+#include "qfactiontyperegistry.h"
+
+QFActionEnvelope::QFActionEnvelope()
+    : m_typeId{0}
+    , m_postedAt{-1}
+    , m_native{false}
+    , m_materialized{true}
+    , m_converted{false}
+    , m_hooked{false}
+{
+}
+
+QFActionEnvelope::QFActionEnvelope(const QString &type, const QJSValue &message)
+    : m_type{type}
+    , m_typeId{QFActionTypeRegistry::intern(type)}
+    , m_message{message}
+    , m_postedAt{-1}
+    , m_native{false}
+    , m_materialized{true}
+    , m_converted{false}
+    , m_hooked{false}
+{
+}
+
+QFActionEnvelope::QFActionEnvelope(const QString &type, const QVariant &message)
+    : m_type{type}
+    , m_typeId{QFActionTypeRegistry::intern(type)}
+    , m_variant{message}
+    , m_postedAt{-1}
+    , m_native{true}
+    , m_materialized{false}
+    , m_converted{true}
+    , m_hooked{false}
+{
+}
+
+QString QFActionEnvelope::type() const
+{
+    return m_type;
+}
+
+int QFActionEnvelope::typeId() const
+{
+    return m_typeId;
+}
+
+bool QFActionEnvelope::isNative() const
+{
+    return m_native;
+}
+
+bool QFActionEnvelope::isMaterialized() const
+{
+    return m_materialized;
+}
+
+QJSValue QFActionEnvelope::message(QQmlEngine *engine)
+{
+    if (!m_materialized && engine)
+    {
+        m_message = engine->toScriptValue<QVariant>(m_variant);
+        m_materialized = true;
+    }
+
+    return m_message;
+}
+
+QVariant QFActionEnvelope::variant()
+{
+    if (!m_converted)
+    {
+        m_variant = m_message.toVariant();
+        m_converted = true;
+    }
+
+    return m_variant;
+}
+
+qint64 QFActionEnvelope::postedAt() const
+{
+    return m_postedAt;
+}
+
+void QFActionEnvelope::setPostedAt(qint64 postedAt)
+{
+    m_postedAt = postedAt;
+}
+
+bool QFActionEnvelope::isHooked() const
+{
+    return m_hooked;
+}
+
+void QFActionEnvelope::setHooked(bool hooked)
+{
+    m_hooked = hooked;
+}
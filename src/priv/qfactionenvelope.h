@@ -0,0 +1,64 @@
+#ifndef QFACTIONENVELOPE_H
+#define QFACTIONENVELOPE_H
+
+#include <QString>
+#include <QVariant>
+#include <QJSValue>
+
+class QQmlEngine;
+
+/// QFActionEnvelope carries an action through the dispatcher (Private class)
+/**
+  An action dispatched from C++ keeps its QVariant message. The QJSValue is created on the first
+  call of message() and reused afterward. An action dispatched from QML works the other way round.
+ */
+
+class QFActionEnvelope
+{
+public:
+    QFActionEnvelope();
+    QFActionEnvelope(const QString &type, const QJSValue &message);
+    QFActionEnvelope(const QString &type, const QVariant &message);
+
+    QString type() const;
+
+    int typeId() const;
+
+    /// True if the action is dispatched from C++
+    bool isNative() const;
+
+    /// True if the QJSValue form of the message is available
+    bool isMaterialized() const;
+
+    /// The message as QJSValue. A native message is converted by the engine once.
+    QJSValue message(QQmlEngine *engine);
+
+    /// The message as QVariant. A script message is converted once.
+    QVariant variant();
+
+    /// The time it is posted to the dispatcher queue by QFProfiler::now(), or -1 if not profiled
+    qint64 postedAt() const;
+
+    void setPostedAt(qint64 postedAt);
+
+    /// True if the action has passed the hook already, so it is delivered without passing it again
+    bool isHooked() const;
+
+    void setHooked(bool hooked);
+
+private:
+    QString m_type;
+    int m_typeId;
+
+    QJSValue m_message;
+    QVariant m_variant;
+
+    qint64 m_postedAt;
+
+    bool m_native;
+    bool m_materialized;
+    bool m_converted;
+    bool m_hooked;
+};
+
+#endif // QFACTIONENVELOPE_H
@@ -0,0 +1,279 @@
+#include <QtCore>
+#include "qfactiontypepatterns.h"
+#include "qfactiontyperegistry.h"
+
+namespace {
+
+struct Node
+{
+    QHash<QChar, int> children;
+
+    // The node reached by "?", or -1
+    int any = -1;
+
+    // The node reached by "*", or -1. It stays active on any character.
+    int star = -1;
+    bool loop = false;
+
+    // Ids of the patterns ending here
+    QVector<int> accepts;
+};
+
+struct Trie
+{
+    QReadWriteLock lock;
+    QHash<QString, int> ids;
+
+    // The root is the first node
+    QVector<Node> nodes{Node()};
+
+    // Matched pattern ids by type id. Cleared when a pattern is added.
+    QHash<int, QVector<int>> cache;
+};
+
+Trie &trie()
+{
+    static Trie instance;
+    return instance;
+}
+
+int addNode(Trie &t)
+{
+    t.nodes.append(Node());
+    return t.nodes.size() - 1;
+}
+
+// Add the nodes reachable without consuming a character, as "*" matches an empty sequence
+void close(const Trie &t, QVector<int> &states, QVector<int> &marks, int generation)
+{
+    for (int i = 0 ; i < states.size(); i++)
+    {
+        const auto star = t.nodes.at(states.at(i)).star;
+
+        if (star >= 0 && marks[star] != generation)
+        {
+            marks[star] = generation;
+            states.append(star);
+        }
+    }
+}
+
+QVector<int> run(const Trie &t, const QString &type)
+{
+    QVector<int> marks(t.nodes.size(), 0);
+    int generation = 1;
+
+    QVector<int> states{0};
+    QVector<int> next;
+    marks[0] = generation;
+    close(t, states, marks, generation);
+
+    for (const auto &c : type)
+    {
+        generation++;
+        next.clear();
+
+        auto add = [&](int node) {
+            if (node >= 0 && marks[node] != generation)
+            {
+                marks[node] = generation;
+                next.append(node);
+            }
+        };
+
+        for (const auto &state : states)
+        {
+            const auto &node = t.nodes.at(state);
+
+            if (node.loop)
+                add(state);
+
+            add(node.children.value(c, -1));
+            add(node.any);
+        }
+
+        close(t, next, marks, generation);
+        states.swap(next);
+
+        if (states.isEmpty())
+            break;
+    }
+
+    QVector<int> result;
+    for (const auto &state : states)
+        result += t.nodes.at(state).accepts;
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    return result;
+}
+
+bool isEscapable(const QString &pattern, int index)
+{
+    if (index >= pattern.size())
+        return false;
+
+    const auto c = pattern.at(index);
+    return c == QLatin1Char('*') || c == QLatin1Char('?') || c == QLatin1Char('\\');
+}
+
+}
+
+bool QFActionTypePatterns::isPattern(const QString &type)
+{
+    for (int i = 0 ; i < type.size(); i++)
+    {
+        const auto c = type.at(i);
+
+        if (c == QLatin1Char('\\') && isEscapable(type, i + 1))
+            i++;
+        else if (c == QLatin1Char('*') || c == QLatin1Char('?'))
+            return true;
+    }
+
+    return false;
+}
+
+QString QFActionTypePatterns::unescape(const QString &type)
+{
+    if (!type.contains(QLatin1Char('\\')))
+        return type;
+
+    QString result;
+    result.reserve(type.size());
+
+    for (int i = 0 ; i < type.size(); i++)
+    {
+        if (type.at(i) == QLatin1Char('\\') && isEscapable(type, i + 1))
+            i++;
+
+        result.append(type.at(i));
+    }
+
+    return result;
+}
+
+int QFActionTypePatterns::compile(const QString &pattern)
+{
+    auto &t = trie();
+
+    {
+        QReadLocker locker(&t.lock);
+        if (auto id = t.ids.value(pattern); id > 0)
+            return id;
+    }
+
+    QWriteLocker locker(&t.lock);
+
+    if (auto id = t.ids.value(pattern); id > 0)
+        return id;
+
+    const auto id = t.ids.size() + 1;
+    t.ids.insert(pattern, id);
+
+    int node = 0;
+
+    for (int i = 0 ; i < pattern.size(); i++)
+    {
+        auto c = pattern.at(i);
+        int child;
+
+        // An escaped wildcard is a literal character
+        const auto escaped = c == QLatin1Char('\\') && isEscapable(pattern, i + 1);
+        if (escaped)
+            c = pattern.at(++i);
+
+        if (!escaped && c == QLatin1Char('*'))
+        {
+            // Consecutive stars are the same as one
+            if (t.nodes.at(node).loop)
+                continue;
+
+            child = t.nodes.at(node).star;
+            if (child < 0)
+            {
+                child = addNode(t);
+                t.nodes[node].star = child;
+                t.nodes[child].loop = true;
+            }
+        }
+        else if (!escaped && c == QLatin1Char('?'))
+        {
+            child = t.nodes.at(node).any;
+            if (child < 0)
+            {
+                child = addNode(t);
+                t.nodes[node].any = child;
+            }
+        }
+        else
+        {
+            child = t.nodes.at(node).children.value(c, -1);
+            if (child < 0)
+            {
+                child = addNode(t);
+                t.nodes[node].children.insert(c, child);
+            }
+        }
+
+        node = child;
+    }
+
+    t.nodes[node].accepts.append(id);
+    t.cache.clear();
+
+    return id;
+}
+
+void QFActionTypePatterns::compile(const QStringList &types, QVector<int> &typeIds, QVector<int> &patternIds)
+{
+    typeIds.clear();
+    patternIds.clear();
+
+    for (const auto &type : types)
+    {
+        auto &ids = isPattern(type) ? patternIds : typeIds;
+        const auto id = isPattern(type) ? compile(type) : QFActionTypeRegistry::intern(unescape(type));
+
+        if (!ids.contains(id))
+            ids << id;
+    }
+}
+
+QVector<int> QFActionTypePatterns::match(int typeId)
+{
+    auto &t = trie();
+
+    {
+        QReadLocker locker(&t.lock);
+
+        if (t.ids.isEmpty())
+            return QVector<int>();
+
+        if (auto iter = t.cache.constFind(typeId); iter != t.cache.cend())
+            return iter.value();
+    }
+
+    const auto type = QFActionTypeRegistry::name(typeId);
+
+    QWriteLocker locker(&t.lock);
+    auto result = run(t, type);
+    t.cache.insert(typeId, result);
+
+    return result;
+}
+
+bool QFActionTypePatterns::matches(const QVector<int> &patternIds, int typeId)
+{
+    if (patternIds.isEmpty() || typeId <= 0)
+        return false;
+
+    const auto matched = match(typeId);
+
+    for (const auto &id : patternIds)
+        if (std::binary_search(matched.cbegin(), matched.cend(), id))
+            return true;
+
+    return false;
+}
@@ -0,0 +1,40 @@
+#ifndef QFACTIONTYPEPATTERNS_H
+#define QFACTIONTYPEPATTERNS_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/// QFActionTypePatterns matches action types against wildcard patterns (Private class)
+/**
+  A pattern is an action type with wildcards. "*" matches any sequence of characters and "?" matches
+  a single character, e.g. "photo/*" matches "photo/load" and "photo/loaded". A backslash escapes
+  "*", "?" and itself, so an action type containing them literally is matched exactly, e.g. "rate\\*".
+
+  Every pattern is compiled into a trie shared by all the components, and a type is matched against
+  all of them in one pass. The ids of the matched patterns are cached per interned type id.
+ */
+
+class QFActionTypePatterns
+{
+public:
+    /// True if the type contains a wildcard, which is not escaped
+    static bool isPattern(const QString &type);
+
+    /// The type with the escapes removed, for a type which is not a pattern
+    static QString unescape(const QString &type);
+
+    /// Compile the pattern. Returns a positive id, which is the same for an equal pattern.
+    static int compile(const QString &pattern);
+
+    /// Split the types into the ids of the exact types and the ids of the patterns
+    static void compile(const QStringList &types, QVector<int> &typeIds, QVector<int> &patternIds);
+
+    /// The ids of the patterns matching the type, in ascending order
+    static QVector<int> match(int typeId);
+
+    /// True if any of the patterns matches the type
+    static bool matches(const QVector<int> &patternIds, int typeId);
+};
+
+#endif // QFACTIONTYPEPATTERNS_H
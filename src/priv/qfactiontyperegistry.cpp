@@ -0,0 +1,93 @@
+#include <QtCore>
+#include "qfactiontyperegistry.h"
+
+namespace {
+
+struct Registry
+{
+    QReadWriteLock lock;
+    QHash<QString, int> ids;
+    QVector<QString> names{QString()};
+};
+
+Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+// The same QString instance is usually passed along the whole dispatch pipeline. Remember the last
+// resolved one so that the hash lookup could be skipped by a pointer comparison.
+thread_local QString lastType;
+thread_local int lastTypeId = 0;
+
+void remember(const QString &type, int typeId)
+{
+    lastType = type;
+    lastTypeId = typeId;
+}
+
+}
+
+int QFActionTypeRegistry::intern(const QString &type)
+{
+    if (auto typeId = lookup(type); typeId > 0)
+        return typeId;
+
+    auto &r = registry();
+    QWriteLocker locker(&r.lock);
+
+    auto typeId = r.ids.value(type);
+    if (typeId == 0)
+    {
+        typeId = r.names.size();
+        r.names.append(type);
+        r.ids.insert(type, typeId);
+    }
+
+    remember(type, typeId);
+    return typeId;
+}
+
+int QFActionTypeRegistry::lookup(const QString &type)
+{
+    if (lastTypeId > 0 && type.isSharedWith(lastType))
+        return lastTypeId;
+
+    auto &r = registry();
+    QReadLocker locker(&r.lock);
+
+    auto typeId = r.ids.value(type);
+    if (typeId > 0)
+        remember(type, typeId);
+
+    return typeId;
+}
+
+QVector<int> QFActionTypeRegistry::intern(const QStringList &types)
+{
+    QVector<int> res;
+    res.reserve(types.size());
+
+    for (const auto &type : types)
+        if (auto typeId = intern(type); !res.contains(typeId))
+            res << typeId;
+
+    return res;
+}
+
+QString QFActionTypeRegistry::name(int typeId)
+{
+    auto &r = registry();
+    QReadLocker locker(&r.lock);
+
+    return typeId > 0 && typeId < r.names.size() ? r.names.at(typeId) : QString();
+}
+
+int QFActionTypeRegistry::count()
+{
+    auto &r = registry();
+    QReadLocker locker(&r.lock);
+
+    return r.names.size() - 1;
+}
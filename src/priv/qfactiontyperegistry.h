@@ -0,0 +1,32 @@
+#ifndef QFACTIONTYPEREGISTRY_H
+#define QFACTIONTYPEREGISTRY_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/// QFActionTypeRegistry interns action types into small integer ids (Private class)
+/**
+  Every distinct action type is assigned a positive id once. Components compare the ids instead
+  of the strings while dispatching. Id 0 is reserved for unknown types.
+ */
+
+class QFActionTypeRegistry
+{
+public:
+    /// Return the id of the type. It is allocated if the type has never been seen before.
+    static int intern(const QString &type);
+
+    /// Return the id of the type, or 0 if it has not been interned.
+    static int lookup(const QString &type);
+
+    static QVector<int> intern(const QStringList &types);
+
+    /// Return the type name of an id
+    static QString name(int typeId);
+
+    /// The number of interned types. Valid ids are in the range [1, count()]
+    static int count();
+};
+
+#endif // QFACTIONTYPEREGISTRY_H
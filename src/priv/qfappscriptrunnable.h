@@ -20,6 +20,8 @@ public:
 
     QString type() const;
 
+    int typeId() const;
+
     void run(const QJSValue &message);
 
     QFAppScriptRunnable *next() const;
@@ -44,6 +46,7 @@ private:
 
     QJSValue m_script;
     QString m_type;
+    int m_typeId;
     QFAppScriptRunnable* m_next;
     QPointer<QQmlEngine> m_engine;
 
@@ -0,0 +1,88 @@
+#include <QtCore>
+#include <QJSEngine>
+#include "qffilterfunctiontable.h"
+#include "quickfluxfunctions.h"
+
+QFFilterFunctionTable *QFFilterFunctionTable::of(const QMetaObject *meta)
+{
+    static QMutex mutex;
+    static QHash<QByteArray, QFFilterFunctionTable*> tables;
+
+    // Each QML type has an unique class name, but every instance may hold its own copy of meta object.
+    const auto className = QByteArray(meta->className());
+
+    QMutexLocker locker(&mutex);
+
+    auto &table = tables[className];
+    if (!table)
+        table = new QFFilterFunctionTable();
+
+    return table;
+}
+
+bool QFFilterFunctionTable::invoke(QObject *object, const QString &type, int typeId, const QJSValue &message)
+{
+    const auto meta = object->metaObject();
+    const auto &functions = resolve(meta, type, typeId);
+
+    if (functions.withMessage >= 0)
+    {
+        auto value = QVariant::fromValue<QJSValue>(message);
+        meta->method(functions.withMessage).invoke(object, Qt::DirectConnection, Q_ARG(QVariant, value));
+    }
+
+    if (functions.withoutMessage >= 0)
+        meta->method(functions.withoutMessage).invoke(object);
+
+    if (functions.property >= 0)
+        return invokeProperty(object, meta->property(functions.property), message);
+
+    return functions.withMessage >= 0 || functions.withoutMessage >= 0;
+}
+
+bool QFFilterFunctionTable::invokeProperty(QObject *object, const QMetaProperty &property, const QJSValue &message)
+{
+    const auto value = property.read(object);
+
+    if (value.userType() != qMetaTypeId<QJSValue>())
+        return false;
+
+    auto function = value.value<QJSValue>();
+    auto engine = qjsEngine(object);
+
+    if (!function.isCallable() || !engine)
+        return false;
+
+    // Called as a method of the object, like the declared functions
+    auto ret = function.callWithInstance(engine->newQObject(object), QJSValueList{} << message);
+
+    if (ret.isError())
+        QuickFlux::printException(ret);
+
+    return true;
+}
+
+bool QFFilterFunctionTable::contains(const QMetaObject *meta, const QString &type, int typeId)
+{
+    const auto &functions = resolve(meta, type, typeId);
+    return functions.withMessage >= 0 || functions.withoutMessage >= 0 || functions.property >= 0;
+}
+
+const QFFilterFunctionTable::Functions &QFFilterFunctionTable::resolve(const QMetaObject *meta, const QString &type, int typeId)
+{
+    if (auto iter = m_functions.constFind(typeId); iter != m_functions.cend())
+        return iter.value();
+
+    auto signature = QMetaObject::normalizedSignature(QStringLiteral("%1(QVariant)").arg(type).toUtf8().constData());
+    auto withMessage = meta->indexOfMethod(signature.constData());
+
+    signature = QMetaObject::normalizedSignature(QStringLiteral("%1()").arg(type).toUtf8().constData());
+    auto withoutMessage = meta->indexOfMethod(signature.constData());
+
+    auto property = -1;
+
+    if (withMessage < 0 && withoutMessage < 0)
+        property = meta->indexOfProperty(type.toUtf8().constData());
+
+    return *m_functions.insert(typeId, Functions{withMessage, withoutMessage, property});
+}
@@ -0,0 +1,50 @@
+#ifndef QFFILTERFUNCTIONTABLE_H
+#define QFFILTERFUNCTIONTABLE_H
+
+#include <QObject>
+#include <QJSValue>
+#include <QHash>
+#include <QMetaProperty>
+
+/// QFFilterFunctionTable caches the filter functions of a type, indexed by action type id (Private class)
+/**
+  Store and Middleware with filterFunctionEnabled call a function named as the action type.
+  Objects of the same QML type share a table, so the method is resolved only once per type,
+  including the negative result. A miss costs a single hash lookup.
+
+  A declared function is preferred. Otherwise a property of the same name holding a JavaScript
+  function is called, e.g. "property var addItem: function(message) {}". Its value is read
+  on every call, since it may differ between the objects.
+ */
+
+class QFFilterFunctionTable
+{
+public:
+    /// Obtain the table shared by all the objects with this meta object. It is never released.
+    static QFFilterFunctionTable *of(const QMetaObject *meta);
+
+    /// Call the filter function of the type on object. It returns false if there is no such function.
+    bool invoke(QObject *object, const QString &type, int typeId, const QJSValue &message);
+
+    /// True if there is a filter function of the type in objects with this meta object
+    bool contains(const QMetaObject *meta, const QString &type, int typeId);
+
+private:
+    struct Functions
+    {
+        // Method index of "type(QVariant)" and "type()". -1 if not found.
+        int withMessage;
+        int withoutMessage;
+
+        // Property index of "type" if there is no such method. -1 if not found.
+        int property;
+    };
+
+    const Functions &resolve(const QMetaObject *meta, const QString &type, int typeId);
+
+    static bool invokeProperty(QObject *object, const QMetaProperty &property, const QJSValue &message);
+
+    QHash<int, Functions> m_functions;
+};
+
+#endif // QFFILTERFUNCTIONTABLE_H
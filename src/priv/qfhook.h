@@ -1,6 +1,7 @@
 #pragma once
 #include <QObject>
 #include <QJSValue>
+#include "./priv/qfactionenvelope.h"
 
 class QFHook : public QObject
 {
@@ -9,6 +10,15 @@ public:
     using QObject::QObject;
     virtual void dispatch(const QString &type, const QJSValue &message) = 0;
 
+    // Called by the dispatcher. A hook that could process a native message without the engine should override it.
+    virtual void dispatchEnvelope(QFActionEnvelope &envelope, QQmlEngine *engine)
+    {
+        dispatch(envelope.type(), envelope.message(engine));
+    }
+
 signals:
     void dispatched(const QString &type, const QJSValue &message);
+
+    // Same as dispatched(), but the message is not converted to QJSValue if it is not needed
+    void envelopeDispatched(const QFActionEnvelope &envelope);
 };
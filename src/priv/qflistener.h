@@ -4,8 +4,7 @@
 #include <QObject>
 #include <QJSValue>
 #include <QVector>
-
-class QFDispatcher;
+#include <QStringList>
 
 /// A listener class for AppDispatcher.
 
@@ -20,7 +19,7 @@ public:
 
     void setCallback(const QJSValue &callback);
 
-    void dispatch(QFDispatcher* dispatcher, const QString &type, const QJSValue &message);
+    void dispatch(const QString &type, int typeId, const QJSValue &message);
 
     int listenerId() const;
 
@@ -30,8 +29,25 @@ public:
 
     void setWaitFor(const QVector<int> &waitFor);
 
+    QStringList types() const;
+
+    QVector<int> typeIds() const;
+
+    /// Ids of the wildcard patterns in the types
+    QVector<int> patternIds() const;
+
+    void setTypes(const QStringList &types);
+
+    void clearTypes();
+
+    bool isCatchAll() const;
+
 signals:
-    void dispatched(const QString &type, const QJSValue &message);
+    void dispatched(const QString &type, const QJSValue &message, int typeId);
+
+    void typesChanged();
+
+    void waitForChanged();
 
 public slots:
 
@@ -41,6 +57,15 @@ private:
     int m_listenerId;
 
     QVector<int> m_waitFor;
+
+    // Action types this listener is interested in. Only used if m_catchAll is false.
+    QStringList m_types;
+
+    QVector<int> m_typeIds;
+
+    QVector<int> m_patternIds;
+
+    bool m_catchAll;
 };
 
 #endif // QFLISTENER_H
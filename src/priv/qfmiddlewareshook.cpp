@@ -1,78 +1,512 @@
+#include <algorithm>
 #include <QtCore>
+#include <QQmlListReference>
 #include "qfmiddlewareshook.h"
-#include "./priv/quickfluxfunctions.h"
+#include "./priv/qfactiontyperegistry.h"
+#include "./priv/qfprofilerscope.h"
+#include "qfmiddleware.h"
+#include "qfnativemiddleware.h"
 
 QFMiddlewaresHook::QFMiddlewaresHook(QObject *parent) : QFHook(parent)
+    , m_dirty(false)
+    , m_generation(0)
+    , m_ordering(QFMiddlewareList::StrictFifo)
+    , m_lastSerial(0)
+    , m_current(0)
+    , m_flushing(false)
 {
 
 }
 
 void QFMiddlewaresHook::dispatch(const QString &type, const QJSValue &message)
 {
+    QFActionEnvelope envelope(type, message);
+    dispatchEnvelope(envelope, m_engine.data());
+}
+
+void QFMiddlewaresHook::dispatchEnvelope(QFActionEnvelope &envelope, QQmlEngine *engine)
+{
+    if (m_engine.isNull())
+        m_engine = engine;
+
+    if (m_dirty)
+        build();
+
     if (m_middlewares.isNull())
-        emit dispatched(type , message);
-    else
-        next(-1, type , message);
+    {
+        emit envelopeDispatched(envelope);
+        return;
+    }
+
+    Ticket ticket;
+    ticket.serial = ++m_lastSerial;
+    ticket.typeId = envelope.typeId();
+    ticket.holds = 1;
+    m_tickets.append(ticket);
+
+    // The synchronous part holds the ticket. Promises and native continuations may extend it.
+    next(-1, ticket.serial, envelope);
+    release(ticket.serial);
 }
 
 void QFMiddlewaresHook::setup(QQmlEngine *engine, QObject *middlewares)
 {
-
+    m_engine = engine;
     m_middlewares = middlewares;
-    auto mobj = engine->newQObject(middlewares);
-    auto hobj = engine->newQObject(this);
-
-    auto source = QStringLiteral("function (middlewares, hook) {"
-                                   "  function create(senderIndex) {"
-                                   "    return function (type, message) {"
-                                   "      hook.next(senderIndex, type , message);"
-                                   "    }"
-                                   "  }"
-                                   "  var data = middlewares.data;"
-                                   "  for (var i = 0 ; i < data.length; i++) {"
-                                   "    var m = data[i];"
-                                   "    m._nextCallback = create(i);"
-                                   "  }"
-                                   "}");
-
-    auto function = engine->evaluate(source);
-    auto args = QJSValueList{} << mobj << hobj;
-
-    if (auto ret = function.call(args); ret.isError())
-        QuickFlux::printException(ret);
-
-    source = QStringLiteral("function (middlewares, hook) {"
-                           "  return function invoke(receiverIndex, type , message) {"
-                           "     if (receiverIndex >= middlewares.data.length) {"
-                           "       hook.resolve(type, message);"
-                           "       return;"
-                           "     }"
-                           "     var m = middlewares.data[receiverIndex];"
-                           "     if (m.filterFunctionEnabled && m.hasOwnProperty(type) && typeof m[type] === \"function\") { "
-                           "       m[type](message);"
-                           "     } else if (m.hasOwnProperty(\"dispatch\") && typeof m.dispatch === \"function\") {"
-                           "       m.dispatch(type, message);"
-                           "     } else {"
-                           "       invoke(receiverIndex + 1,type, message);"
-                           "     }"
-                           "  }"
-                            "}");
-
-    function = engine->evaluate(source);
-    invoke = function.call(args);
-    if (invoke.isError())
-        QuickFlux::printException(invoke);
+    build();
+}
+
+void QFMiddlewaresHook::invalidate()
+{
+    m_dirty = true;
+}
+
+QFMiddlewareList::Ordering QFMiddlewaresHook::ordering() const
+{
+    return m_ordering;
+}
+
+void QFMiddlewaresHook::setOrdering(QFMiddlewareList::Ordering ordering)
+{
+    m_ordering = ordering;
+    flush();
+}
+
+void QFMiddlewaresHook::invalidateRoutes()
+{
+    m_routes.clear();
+}
+
+void QFMiddlewaresHook::build()
+{
+    for (const auto &entry : qAsConst(m_entries))
+        if (!entry.object.isNull())
+            entry.object->disconnect(this);
+
+    m_dirty = false;
+    m_generation++;
+    m_entries.clear();
+    m_routes.clear();
+
+    if (m_middlewares.isNull())
+        return;
+
+    // Members of MiddlewareList.data in the declaration order. The data property lists resources before items.
+    QQmlListReference data(m_middlewares.data(), "data");
+    QSet<QObject*> members;
+
+    for (int i = 0 ; i < data.count(); i++)
+        members.insert(data.at(i));
+
+    for (auto object : m_middlewares->children())
+    {
+        if (!members.contains(object))
+            continue;
+
+        Entry entry;
+        entry.object = object;
+        entry.middleware = qobject_cast<QFMiddleware*>(object);
+        entry.native = qobject_cast<QFNativeMiddleware*>(object);
+
+        const auto meta = object->metaObject();
+        const char *signatures[] = {"dispatch(QVariant,QVariant,QVariant)", "dispatch(QVariant,QVariant)", "dispatch(QVariant)", "dispatch()"};
+
+        for (int argc = 3 ; entry.native.isNull() && argc >= 0; argc--)
+        {
+            if (auto index = meta->indexOfMethod(signatures[3 - argc]); index >= 0)
+            {
+                entry.dispatchIndex = index;
+                entry.dispatchArgc = argc;
+                entry.returnsValue = meta->method(index).returnType() == QMetaType::QVariant;
+                break;
+            }
+        }
+
+        if (entry.middleware)
+        {
+            entry.middleware->setHook(this, m_entries.size());
+            entry.typeIds = QFActionTypeRegistry::intern(entry.middleware->types());
+
+            connect(entry.middleware.data(), &QFMiddleware::typesChanged, this, &QFMiddlewaresHook::invalidate);
+            connect(entry.middleware.data(), &QFMiddleware::filterFunctionEnabledChanged, this, &QFMiddlewaresHook::invalidateRoutes);
+        }
+        else if (entry.native)
+        {
+            entry.typeIds = QFActionTypeRegistry::intern(entry.native->types());
+
+            connect(entry.native.data(), &QFNativeMiddleware::typesChanged, this, &QFMiddlewaresHook::invalidate);
+        }
+
+        m_entries.append(entry);
+    }
+}
+
+void QFMiddlewaresHook::next(int senderIndex, const QFActionEnvelope &envelope)
+{
+    next(senderIndex, serialOf(senderIndex), envelope);
+}
+
+void QFMiddlewaresHook::next(int senderIndex, qint64 serial, const QFActionEnvelope &envelope)
+{
+    // It includes the rest of the chain called by next()
+    QFProfilerScope profilerScope(QFProfiler::Middleware, QFProfiler::isActive() ? middlewareAt(senderIndex + 1) : nullptr, envelope.typeId());
+
+    const auto current = m_current;
+    m_current = serial;
+
+    auto copy = envelope;
+    invoke(senderIndex + 1, copy);
+
+    m_current = current;
 }
 
 void QFMiddlewaresHook::next(int senderIndex, const QString &type, const QJSValue &message)
 {
-    auto args = QJSValueList{} << QJSValue(senderIndex + 1) << QJSValue(type) << message;
+    // Keep the native message if the middleware passes the action through
+    if (m_pending.isMaterialized() && m_pending.type() == type &&
+        m_pending.message(m_engine.data()).strictlyEquals(message))
+    {
+        next(senderIndex, m_pending);
+        return;
+    }
 
-    if (auto result = invoke.call(args); result.isError())
-        QuickFlux::printException(result);
+    next(senderIndex, QFActionEnvelope(type, message));
 }
 
 void QFMiddlewaresHook::resolve(const QString &type, const QJSValue &message)
 {
     emit dispatched(type, message);
 }
+
+void QFMiddlewaresHook::proceed(QObject *sender, int senderIndex, int generation, qint64 serial, const QFActionEnvelope &envelope)
+{
+    if (generation != m_generation)
+    {
+        senderIndex = -1;
+
+        // The sender is only compared. It may be destroyed already.
+        for (int i = 0 ; i < m_entries.size() && senderIndex < 0; i++)
+            if (m_entries.at(i).object.data() == sender)
+                senderIndex = i;
+
+        if (senderIndex < 0)
+        {
+            qWarning() << "Middleware: The middleware is removed before it passes the action on. The action is dropped:" << envelope.type();
+            return;
+        }
+    }
+
+    next(senderIndex, serial, envelope);
+}
+
+int QFMiddlewaresHook::generation() const
+{
+    return m_generation;
+}
+
+void QFMiddlewaresHook::resume(QObject *sender, int senderIndex, int generation, qint64 serial, const QString &type, const QJSValue &message)
+{
+    proceed(sender, senderIndex, generation, serial, QFActionEnvelope(type, message));
+}
+
+void QFMiddlewaresHook::settle(int senderIndex, qint64 serial)
+{
+    if (senderIndex >= 0 && senderIndex < m_entries.size())
+        m_entries[senderIndex].inflight.removeOne(serial);
+
+    release(serial);
+}
+
+void QFMiddlewaresHook::reject(int senderIndex, qint64 serial, const QJSValue &error)
+{
+    qWarning().noquote() << QString("Middleware: The promise of dispatch() is rejected: %1").arg(error.toString());
+
+    settle(senderIndex, serial);
+}
+
+void QFMiddlewaresHook::hold(qint64 serial)
+{
+    if (auto index = indexOfTicket(serial); index >= 0)
+        m_tickets[index].holds++;
+}
+
+void QFMiddlewaresHook::release(qint64 serial)
+{
+    auto index = indexOfTicket(serial);
+    if (index < 0)
+        return;
+
+    if (--m_tickets[index].holds > 0)
+        return;
+
+    flush();
+}
+
+void QFMiddlewaresHook::invoke(int receiverIndex, QFActionEnvelope &envelope)
+{
+    const auto &indexes = route(envelope);
+
+    // Jump to the next entry interested in the type. Only the body of a middleware runs in JavaScript.
+    for (auto iter = std::lower_bound(indexes.cbegin(), indexes.cend(), receiverIndex); iter != indexes.cend(); ++iter)
+    {
+        const auto i = *iter;
+        const auto &entry = m_entries.at(i);
+
+        if (entry.object.isNull())
+            continue;
+
+        if (auto native = entry.native.data())
+        {
+            // A copy of next kept by the middleware holds the action in flight
+            native->process(envelope.type(), envelope, QFNativeMiddleware::Next(this, i, m_current));
+            return;
+        }
+
+        if (entry.middleware.isNull() && entry.dispatchIndex < 0)
+            continue;
+
+        // QML middlewares need the QJSValue
+        const auto message = envelope.message(m_engine.data());
+        m_pending = envelope;
+
+        // A next() called by the middleware meanwhile belongs to this action
+        const auto running = entry.running;
+        m_entries[i].running = m_current;
+
+        auto invoked = !entry.middleware.isNull() && entry.middleware->invokeFilterFunction(envelope.type(), envelope.typeId(), message);
+
+        if (!invoked && entry.dispatchIndex >= 0)
+        {
+            invokeScript(i, envelope);
+            invoked = true;
+        }
+
+        if (i < m_entries.size())
+            m_entries[i].running = running;
+
+        if (invoked)
+            return;
+    }
+
+    m_pending = QFActionEnvelope();
+    output(envelope);
+}
+
+void QFMiddlewaresHook::invokeScript(int index, QFActionEnvelope &envelope)
+{
+    const auto &entry = m_entries.at(index);
+    auto object = entry.object.data();
+
+    const auto method = object->metaObject()->method(entry.dispatchIndex);
+    const auto type = QVariant(envelope.type());
+    const auto value = QVariant::fromValue<QJSValue>(envelope.message(m_engine.data()));
+    const auto serial = m_current;
+
+    QVariant continuation;
+
+    if (entry.dispatchArgc == 3)
+    {
+        if (m_bindNext.isUndefined() && m_engine)
+        {
+            m_bindNext = m_engine->evaluate("(function(hook, sender, index, generation, serial) {"
+                                            "  return function(type, message) { hook.resume(sender, index, generation, serial, type, message); };"
+                                            "})");
+        }
+
+        continuation = QVariant::fromValue<QJSValue>(m_bindNext.call({m_engine->newQObject(this), m_engine->newQObject(object),
+                                                                      index, m_generation, double(serial)}));
+    }
+
+    QVariant result;
+    QGenericReturnArgument returnArgument;
+
+    if (entry.returnsValue)
+        returnArgument = Q_RETURN_ARG(QVariant, result);
+
+    switch (entry.dispatchArgc)
+    {
+    case 3:
+        method.invoke(object, Qt::DirectConnection, returnArgument, Q_ARG(QVariant, type), Q_ARG(QVariant, value), Q_ARG(QVariant, continuation));
+        break;
+    case 2:
+        method.invoke(object, Qt::DirectConnection, returnArgument, Q_ARG(QVariant, type), Q_ARG(QVariant, value));
+        break;
+    case 1:
+        method.invoke(object, Qt::DirectConnection, returnArgument, Q_ARG(QVariant, type));
+        break;
+    default:
+        method.invoke(object, Qt::DirectConnection, returnArgument);
+        break;
+    }
+
+    if (!result.canConvert<QJSValue>() || serial == 0 || !m_engine)
+        return;
+
+    // A promise keeps the action in flight until it is settled
+    auto promise = result.value<QJSValue>();
+    if (!promise.isObject() || !promise.property("then").isCallable())
+        return;
+
+    if (m_watchPromise.isUndefined())
+    {
+        m_watchPromise = m_engine->evaluate("(function(hook, promise, index, serial) {"
+                                            "  promise.then(function() { hook.settle(index, serial); },"
+                                            "               function(error) { hook.reject(index, serial, error); });"
+                                            "})");
+    }
+
+    hold(serial);
+    m_entries[index].inflight.append(serial);
+    m_watchPromise.call({m_engine->newQObject(this), promise, index, double(serial)});
+}
+
+qint64 QFMiddlewaresHook::serialOf(int senderIndex) const
+{
+    // The start of the chain
+    if (senderIndex < 0)
+        return m_current;
+
+    if (senderIndex >= m_entries.size())
+        return 0;
+
+    const auto &entry = m_entries.at(senderIndex);
+
+    // Called by the running dispatch() of the middleware
+    if (entry.running != 0)
+        return entry.running;
+
+    // Called from a continuation of a promise. Only a single action waiting for this middleware is certain.
+    if (entry.inflight.size() == 1)
+        return entry.inflight.first();
+
+    if (entry.inflight.size() > 1)
+        qWarning() << "Middleware: next() is called while several promises are pending. Use the next passed to dispatch(type, message, next) to keep the order.";
+
+    return 0;
+}
+
+int QFMiddlewaresHook::indexOfTicket(qint64 serial) const
+{
+    auto iter = std::lower_bound(m_tickets.cbegin(), m_tickets.cend(), serial, [](const Ticket &ticket, qint64 serial) {
+        return ticket.serial < serial;
+    });
+
+    if (iter == m_tickets.cend() || iter->serial != serial)
+        return -1;
+
+    return int(iter - m_tickets.cbegin());
+}
+
+bool QFMiddlewaresHook::isBlocked(int ticketIndex) const
+{
+    if (m_ordering == QFMiddlewareList::StrictFifo)
+        return ticketIndex > 0;
+
+    const auto typeId = m_tickets.at(ticketIndex).typeId;
+
+    for (int i = 0 ; i < ticketIndex; i++)
+        if (m_tickets.at(i).typeId == typeId)
+            return true;
+
+    return false;
+}
+
+void QFMiddlewaresHook::output(const QFActionEnvelope &envelope)
+{
+    const auto index = indexOfTicket(m_current);
+
+    // Not tracked. e.g next() called by a dialog after the action is finished.
+    if (index < 0)
+    {
+        emit envelopeDispatched(envelope);
+        return;
+    }
+
+    if (!m_flushing && !isBlocked(index))
+    {
+        emit envelopeDispatched(envelope);
+        return;
+    }
+
+    m_tickets[index].outputs.append(envelope);
+}
+
+void QFMiddlewaresHook::flush()
+{
+    // The outputs released in a nested call are picked up by the outer loop, in order
+    if (m_flushing)
+        return;
+
+    m_flushing = true;
+
+    QFActionEnvelope envelope;
+    while (takeOutput(envelope))
+        emit envelopeDispatched(envelope);
+
+    m_flushing = false;
+}
+
+bool QFMiddlewaresHook::takeOutput(QFActionEnvelope &envelope)
+{
+    for (int i = 0 ; i < m_tickets.size(); )
+    {
+        auto &ticket = m_tickets[i];
+
+        if (!ticket.outputs.isEmpty() && !isBlocked(i))
+        {
+            envelope = ticket.outputs.takeFirst();
+            return true;
+        }
+
+        if (ticket.holds <= 0 && ticket.outputs.isEmpty())
+        {
+            m_tickets.remove(i);
+            continue;
+        }
+
+        i++;
+    }
+
+    return false;
+}
+
+const QVector<int> &QFMiddlewaresHook::route(const QFActionEnvelope &envelope)
+{
+    const auto typeId = envelope.typeId();
+
+    if (auto iter = m_routes.constFind(typeId); iter != m_routes.cend())
+        return iter.value();
+
+    QVector<int> indexes;
+    const auto type = envelope.type();
+
+    for (int i = 0 ; i < m_entries.size(); i++)
+        if (accepts(m_entries.at(i), type, typeId))
+            indexes.append(i);
+
+    return *m_routes.insert(typeId, indexes);
+}
+
+bool QFMiddlewaresHook::accepts(const Entry &entry, const QString &type, int typeId) const
+{
+    if (entry.object.isNull())
+        return false;
+
+    if (!entry.typeIds.isEmpty())
+        return entry.typeIds.contains(typeId);
+
+    if (!entry.native.isNull() || entry.dispatchIndex >= 0)
+        return true;
+
+    // Inferred from the filter functions
+    return !entry.middleware.isNull() && entry.middleware->hasFilterFunction(type, typeId);
+}
+
+QObject *QFMiddlewaresHook::middlewareAt(int index) const
+{
+    // The last next() resolves the action. It is measured by the dispatcher.
+    if (index < 0 || index >= m_entries.size())
+        return nullptr;
+
+    return m_entries.at(index).object.data();
+}
@@ -4,7 +4,13 @@
 #include <QObject>
 #include <QQmlEngine>
 #include <QPointer>
+#include <QVector>
+#include <QHash>
 #include "./priv/qfhook.h"
+#include "qfmiddlewarelist.h"
+
+class QFMiddleware;
+class QFNativeMiddleware;
 
 class QFMiddlewaresHook : public QFHook
 {
@@ -14,16 +20,134 @@ public:
 
 public:
     void dispatch(const QString &type, const QJSValue &message) override;
+    void dispatchEnvelope(QFActionEnvelope &envelope, QQmlEngine *engine) override;
     void setup(QQmlEngine* engine, QObject* middlewares);
 
+    // The middlewares are changed. The chain is rebuilt before the next action.
+    void invalidate();
+
+    QFMiddlewareList::Ordering ordering() const;
+    void setOrdering(QFMiddlewareList::Ordering ordering);
+
+    void next(int senderIndex, const QFActionEnvelope &envelope);
+
+    // Continue the chain on behalf of the action with the serial. 0 if the action is unknown.
+    void next(int senderIndex, qint64 serial, const QFActionEnvelope &envelope);
+
+    // Continue the chain after the sender, which was at senderIndex in the chain of the generation.
+    // If the chain is rebuilt since then, it continues after the sender in the new chain, or drops
+    // the action if the sender is removed.
+    void proceed(QObject *sender, int senderIndex, int generation, qint64 serial, const QFActionEnvelope &envelope);
+
+    // Incremented whenever the chain is rebuilt
+    int generation() const;
+
+    QObject *middlewareAt(int index) const;
+
+    // Keep the action with the serial in flight, until the same number of release() is called.
+    void hold(qint64 serial);
+    void release(qint64 serial);
+
 public slots:
+    void invalidateRoutes();
+
     void next(int senderId, const QString &type, const QJSValue &message);
     void resolve(const QString &type, const QJSValue &message);
 
+    // Called by the continuation passed to dispatch(type, message, next)
+    void resume(QObject *sender, int senderIndex, int generation, qint64 serial, const QString &type, const QJSValue &message);
+
+    // Called when a promise returned by a middleware is settled
+    void settle(int senderIndex, qint64 serial);
+    void reject(int senderIndex, qint64 serial, const QJSValue &error);
 
 private:
-    QJSValue invoke;
+    // A middleware with its dispatch function resolved in advance
+    struct Entry
+    {
+        QPointer<QObject> object;
+        QPointer<QFMiddleware> middleware;
+        QPointer<QFNativeMiddleware> native;
+
+        // Method index of dispatch() and its number of parameters. -1 if it is not declared.
+        int dispatchIndex = -1;
+        int dispatchArgc = 0;
+
+        // True if dispatch() returns a value, which may be a promise
+        bool returnsValue = false;
+
+        // The declared types. Empty for all types.
+        QVector<int> typeIds;
+
+        // The serials of the actions waiting for a promise returned by this middleware, in arrival order
+        QVector<qint64> inflight;
+
+        // The action passed to the running dispatch() or filter function of this middleware. 0 if it is not running.
+        qint64 running = 0;
+    };
+
+    // An action that entered the chain and has not finished yet
+    struct Ticket
+    {
+        qint64 serial = 0;
+        int typeId = 0;
+        int holds = 0;
+
+        // Resolved actions waiting for the earlier tickets
+        QVector<QFActionEnvelope> outputs;
+    };
+
+    void build();
+
+    // Indexes of the entries interested in the type, in chain order
+    const QVector<int> &route(const QFActionEnvelope &envelope);
+
+    bool accepts(const Entry &entry, const QString &type, int typeId) const;
+
+    void invoke(int receiverIndex, QFActionEnvelope &envelope);
+
+    void invokeScript(int index, QFActionEnvelope &envelope);
+
+    // The action continued by a call of next() without the serial from the middleware. 0 if it is ambiguous.
+    qint64 serialOf(int senderIndex) const;
+
+    int indexOfTicket(qint64 serial) const;
+
+    bool isBlocked(int ticketIndex) const;
+
+    void output(const QFActionEnvelope &envelope);
+
+    // Emit the outputs released by the policy, in order
+    void flush();
+
+    bool takeOutput(QFActionEnvelope &envelope);
+
+    QPointer<QQmlEngine> m_engine;
     QPointer<QObject> m_middlewares;
+    QVector<Entry> m_entries;
+    bool m_dirty;
+    int m_generation;
+
+    // Jump table by type id. It is cleared when the chain or the types of a middleware are changed.
+    QHash<int, QVector<int>> m_routes;
+
+    // The action passed to the last QML middleware. It is reused if the middleware passes it through unchanged.
+    QFActionEnvelope m_pending;
+
+    QFMiddlewareList::Ordering m_ordering;
+
+    // In serial order
+    QVector<Ticket> m_tickets;
+    qint64 m_lastSerial;
+
+    // The action running synchronously through the chain
+    qint64 m_current;
+
+    bool m_flushing;
+
+    // JavaScript helpers created on demand
+    QJSValue m_watchPromise;
+    QJSValue m_bindNext;
 };
 
 #endif // QFMIDDLEWARESHOOK_H
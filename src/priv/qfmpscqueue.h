@@ -0,0 +1,107 @@
+#ifndef QFMPSCQUEUE_H
+#define QFMPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+/// A lock-free multi-producer / single-consumer queue (Private class)
+/**
+  push() may be called from any thread. pop() must only be called by a single consumer thread.
+
+  It is an intrusive linked list based on Dmitry Vyukov's MPSC queue. A producer only performs
+  an atomic exchange and a store, and it never waits for other producers or the consumer.
+ */
+
+template <typename T>
+class QFMpscQueue
+{
+public:
+    QFMpscQueue()
+        : m_head{&m_stub}
+        , m_tail{&m_stub}
+    {
+    }
+
+    ~QFMpscQueue()
+    {
+        T value;
+        while (pop(value)) {
+        }
+    }
+
+    QFMpscQueue(const QFMpscQueue &) = delete;
+    QFMpscQueue &operator=(const QFMpscQueue &) = delete;
+
+    void push(T value)
+    {
+        auto node = new Node;
+        node->value = std::move(value);
+        link(node);
+    }
+
+    /// Take the oldest value. It returns false if the queue is empty, or the next value is not completely pushed yet.
+    bool pop(T &value)
+    {
+        auto tail = m_tail;
+        auto next = tail->next.load(std::memory_order_acquire);
+
+        if (tail == &m_stub)
+        {
+            if (!next)
+                return false;
+
+            m_tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if (next)
+        {
+            m_tail = next;
+            value = std::move(tail->value);
+            delete tail;
+            return true;
+        }
+
+        // A producer is in the middle of push()
+        if (tail != m_head.load(std::memory_order_acquire))
+            return false;
+
+        link(&m_stub);
+
+        next = tail->next.load(std::memory_order_acquire);
+        if (next)
+        {
+            m_tail = next;
+            value = std::move(tail->value);
+            delete tail;
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    struct Node
+    {
+        std::atomic<Node*> next{nullptr};
+        T value;
+    };
+
+    void link(Node *node)
+    {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        auto prev = m_head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    Node m_stub;
+
+    // Last pushed node. Shared by producers.
+    std::atomic<Node*> m_head;
+
+    // Next node to be consumed. Only accessed by the consumer.
+    Node* m_tail;
+};
+
+#endif // QFMPSCQUEUE_H
@@ -0,0 +1,113 @@
+#include <QMetaProperty>
+#include <QThread>
+#include <QtCore/private/qobject_p.h>
+#include <QtCore/private/qmetaobject_p.h>
+#include "qfnotifyholder.h"
+
+namespace {
+
+using SignalEmitted = void (*)(QAbstractDeclarativeData *, QObject *, int, void **);
+
+// The hook of QtQml, which delivers a signal to the bindings and signal handlers
+SignalEmitted declarativeSignalEmitted = nullptr;
+
+bool hooked = false;
+
+// The thread of the holders. Signals emitted by other threads are passed through.
+Qt::HANDLE holderThread = nullptr;
+
+// Active holders, the innermost last. The hook is installed only while it is not empty.
+QVector<QFNotifyHolder *> holders;
+
+void holdSignalEmitted(QAbstractDeclarativeData *data, QObject *object, int signalIndex, void **args)
+{
+    if (QThread::currentThreadId() == holderThread)
+    {
+        for (int i = holders.size() - 1; i >= 0; i--)
+            if (holders.at(i)->hold(object, signalIndex))
+                return;
+    }
+
+    if (declarativeSignalEmitted)
+        declarativeSignalEmitted(data, object, signalIndex, args);
+}
+
+void push(QFNotifyHolder *holder)
+{
+    Q_ASSERT(holders.isEmpty() || holderThread == QThread::currentThreadId());
+
+    holders.append(holder);
+    holderThread = QThread::currentThreadId();
+
+    if (hooked)
+        return;
+
+    hooked = true;
+    declarativeSignalEmitted = QAbstractDeclarativeData::signalEmitted;
+    QAbstractDeclarativeData::signalEmitted = holdSignalEmitted;
+}
+
+void pop(QFNotifyHolder *holder)
+{
+    holders.removeOne(holder);
+
+    if (holders.isEmpty())
+        holderThread = nullptr;
+
+    // Another hook chained after this one keeps calling it, so it stays until that one is removed
+    if (!holders.isEmpty() || !hooked || QAbstractDeclarativeData::signalEmitted != holdSignalEmitted)
+        return;
+
+    hooked = false;
+    QAbstractDeclarativeData::signalEmitted = declarativeSignalEmitted;
+}
+
+}
+
+QFNotifyHolder::QFNotifyHolder(QObject *object, int propertyOffset) : m_object(object), m_active(true)
+{
+    const auto meta = object->metaObject();
+
+    // The hook receives signal indexes, which are not method indexes
+    for (int i = propertyOffset; i < meta->propertyCount(); i++)
+    {
+        const auto signal = meta->property(i).notifySignal();
+        if (signal.isValid() && signal.parameterCount() == 0)
+            m_notifySignals.append(QMetaObjectPrivate::signalIndex(signal));
+    }
+
+    push(this);
+}
+
+QFNotifyHolder::~QFNotifyHolder()
+{
+    release();
+}
+
+void QFNotifyHolder::release()
+{
+    if (!m_active)
+        return;
+
+    m_active = false;
+    pop(this);
+
+    const auto data = QObjectPrivate::get(m_object)->declarativeData;
+    if (!data || !declarativeSignalEmitted)
+        return;
+
+    void *args[] = { nullptr };
+    for (const auto signalIndex : qAsConst(m_held))
+        declarativeSignalEmitted(data, m_object, signalIndex, args);
+}
+
+bool QFNotifyHolder::hold(QObject *object, int signalIndex)
+{
+    if (object != m_object || !m_notifySignals.contains(signalIndex))
+        return false;
+
+    if (!m_held.contains(signalIndex))
+        m_held.append(signalIndex);
+
+    return true;
+}
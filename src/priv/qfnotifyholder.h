@@ -0,0 +1,39 @@
+#ifndef QFNOTIFYHOLDER_H
+#define QFNOTIFYHOLDER_H
+
+#include <QObject>
+#include <QVector>
+
+/// QFNotifyHolder defers the property change signals of an object to QML while it exists (Private class)
+/**
+  Only the change signals of the properties declared in QML are held, and only for QML bindings and
+  signal handlers. Every other signal, and every C++ connection, is delivered as usual. When the holder
+  is released, each held signal is emitted once, in the order it was first emitted.
+
+  It chains a hook of the private API of QtCore while any holder exists. The hook is installed and
+  removed by the thread of the QML engine.
+ */
+
+class QFNotifyHolder
+{
+public:
+    /// Hold the change signals of the properties from propertyOffset on
+    QFNotifyHolder(QObject *object, int propertyOffset);
+    ~QFNotifyHolder();
+
+    /// Stop holding and emit the held signals
+    void release();
+
+    /// Hold a signal emitted by object to QML. Returns false if it is not held by this holder.
+    bool hold(QObject *object, int signalIndex);
+
+private:
+    Q_DISABLE_COPY(QFNotifyHolder)
+
+    QObject *m_object;
+    QVector<int> m_notifySignals;
+    QVector<int> m_held;
+    bool m_active;
+};
+
+#endif // QFNOTIFYHOLDER_H
@@ -0,0 +1,44 @@
+#ifndef QFPROFILERSCOPE_H
+#define QFPROFILERSCOPE_H
+
+#include "qfprofiler.h"
+#include "priv/qfactiontyperegistry.h"
+
+/// QFProfilerScope measures the time until the end of the scope (Private class)
+/**
+  Nothing is measured unless QFProfiler is enabled or tracing when the scope begins and the receiver is set.
+ */
+
+class QFProfilerScope
+{
+public:
+    QFProfilerScope(QFProfiler::Category category, const QObject *receiver, int typeId)
+        : m_category{category}
+        , m_receiver{receiver}
+        , m_typeId{typeId}
+        , m_start{receiver && QFProfiler::isActive() ? QFProfiler::now() : -1}
+    {
+    }
+
+    QFProfilerScope(QFProfiler::Category category, const QObject *receiver, const QString &type)
+        : QFProfilerScope(category, receiver, QFProfiler::isActive() ? QFActionTypeRegistry::intern(type) : 0)
+    {
+    }
+
+    ~QFProfilerScope()
+    {
+        if (m_start >= 0)
+            QFProfiler::instance()->span(m_category, m_receiver, m_typeId, m_start, QFProfiler::now());
+    }
+
+    QFProfilerScope(const QFProfilerScope &) = delete;
+    QFProfilerScope &operator=(const QFProfilerScope &) = delete;
+
+private:
+    QFProfiler::Category m_category;
+    const QObject *m_receiver;
+    int m_typeId;
+    qint64 m_start;
+};
+
+#endif // QFPROFILERSCOPE_H
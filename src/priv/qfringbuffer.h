@@ -0,0 +1,107 @@
+#ifndef QFRINGBUFFER_H
+#define QFRINGBUFFER_H
+
+#include <vector>
+#include <utility>
+
+/// A FIFO queue on a growable ring buffer (Private class)
+/**
+  Values are moved in and out of slots allocated in advance, so a queue that has reached its
+  working size never allocates again. The capacity is a power of two. It is doubled when the
+  queue is full and never shrinks, so the buffer is reused across dispatch cycles.
+
+  It works with move-only types.
+ */
+
+template <typename T>
+class QFRingBuffer
+{
+public:
+    enum {
+        InitialCapacity = 16
+    };
+
+    QFRingBuffer()
+        : m_head{0}
+        , m_size{0}
+    {
+    }
+
+    QFRingBuffer(const QFRingBuffer &) = delete;
+    QFRingBuffer &operator=(const QFRingBuffer &) = delete;
+
+    int size() const
+    {
+        return m_size;
+    }
+
+    bool isEmpty() const
+    {
+        return m_size == 0;
+    }
+
+    int capacity() const
+    {
+        return int(m_slots.size());
+    }
+
+    void enqueue(T &&value)
+    {
+        if (m_size == capacity())
+            grow();
+
+        m_slots[slot(m_size)] = std::move(value);
+        m_size++;
+    }
+
+    /// Take the oldest value. The queue must not be empty.
+    T dequeue()
+    {
+        // The slot is left moved-from. Assigning a new T() could allocate.
+        T value(std::move(m_slots[m_head]));
+
+        m_head = slot(1);
+        m_size--;
+
+        return value;
+    }
+
+    /// The value at the index from the oldest one
+    T &operator[](int index)
+    {
+        return m_slots[slot(index)];
+    }
+
+    const T &operator[](int index) const
+    {
+        return m_slots[slot(index)];
+    }
+
+    T &last()
+    {
+        return m_slots[slot(m_size - 1)];
+    }
+
+private:
+    int slot(int index) const
+    {
+        return (m_head + index) & (capacity() - 1);
+    }
+
+    void grow()
+    {
+        std::vector<T> slots(m_slots.empty() ? int(InitialCapacity) : m_slots.size() * 2);
+
+        for (int i = 0 ; i < m_size; i++)
+            slots[i] = std::move(m_slots[slot(i)]);
+
+        m_slots.swap(slots);
+        m_head = 0;
+    }
+
+    std::vector<T> m_slots;
+    int m_head;
+    int m_size;
+};
+
+#endif // QFRINGBUFFER_H
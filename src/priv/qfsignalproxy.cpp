@@ -1,6 +1,7 @@
 #include <QtCore>
 #include <QMetaObject>
 #include "qfsignalproxy.h"
+#include "qfactiontyperegistry.h"
 
 QFSignalProxy::QFSignalProxy(QObject *parent)
     : QObject{parent}
@@ -16,6 +17,7 @@ void QFSignalProxy::bind(QObject *source, int signalIdx, QQmlEngine* engine, QFD
     parameterTypes = QVector<int>(method.parameterCount());
     parameterNames = QVector<QString>(method.parameterCount());
     type = method.name();
+    QFActionTypeRegistry::intern(type);
     m_engine = engine;
     m_dispatcher = dispatcher;
 
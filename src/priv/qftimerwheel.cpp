@@ -0,0 +1,126 @@
+#include <climits>
+#include <QThreadStorage>
+#include "qftimerwheel.h"
+
+QFTimerWheel::QFTimerWheel(QObject *parent)
+    : QObject(parent)
+    , m_slots(SlotCount)
+    , m_cursor(0)
+    , m_nextId(1)
+    , m_ticks(0)
+    , m_ticking(false)
+{
+    m_timer.setInterval(Resolution);
+    m_timer.setTimerType(Qt::CoarseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &QFTimerWheel::tick);
+}
+
+QFTimerWheel *QFTimerWheel::local()
+{
+    static QThreadStorage<QFTimerWheel*> wheels;
+
+    if (!wheels.hasLocalData())
+        wheels.setLocalData(new QFTimerWheel());
+
+    return wheels.localData();
+}
+
+int QFTimerWheel::start(int msec, std::function<void()> callback)
+{
+    // Started by a callback of tick(). The clock keeps running, as tick() compares with it afterwards.
+    if (m_slotOf.isEmpty() && !m_ticking)
+    {
+        m_clock.start();
+        m_ticks = 0;
+    }
+
+    if (!m_timer.isActive())
+        m_timer.start();
+
+    // Round up, so it never fires early. The cursor may be behind if the event loop is busy.
+    const auto lag = int(qMax<qint64>(0, m_clock.elapsed() / Resolution - m_ticks));
+    const int ticks = qMax(1, (msec + Resolution - 1) / Resolution) + lag;
+    const int slot = (m_cursor + ticks) % SlotCount;
+
+    const int id = m_nextId;
+    m_nextId = m_nextId == INT_MAX ? 1 : m_nextId + 1;
+
+    m_slots[slot].append(Entry{id, (ticks - 1) / SlotCount, std::move(callback)});
+    m_slotOf.insert(id, slot);
+
+    return id;
+}
+
+void QFTimerWheel::cancel(int id)
+{
+    auto iter = m_slotOf.find(id);
+    if (iter == m_slotOf.end())
+        return;
+
+    auto &entries = m_slots[iter.value()];
+    m_slotOf.erase(iter);
+
+    for (int i = 0 ; i < entries.size(); i++)
+    {
+        if (entries.at(i).id == id)
+        {
+            entries.remove(i);
+            break;
+        }
+    }
+
+    if (m_slotOf.isEmpty())
+        m_timer.stop();
+}
+
+int QFTimerWheel::pendingCount() const
+{
+    return m_slotOf.size();
+}
+
+void QFTimerWheel::tick()
+{
+    // Catch up the ticks missed by a busy event loop
+    const auto due = m_clock.elapsed() / Resolution;
+
+    m_ticking = true;
+
+    while (m_ticks < due && !m_slotOf.isEmpty())
+    {
+        m_ticks++;
+        advance();
+    }
+
+    m_ticking = false;
+
+    if (m_slotOf.isEmpty())
+        m_timer.stop();
+}
+
+void QFTimerWheel::advance()
+{
+    m_cursor = (m_cursor + 1) % SlotCount;
+
+    auto &entries = m_slots[m_cursor];
+    QVector<std::function<void()>> expired;
+
+    for (int i = 0 ; i < entries.size(); )
+    {
+        auto &entry = entries[i];
+
+        if (entry.rounds > 0)
+        {
+            entry.rounds--;
+            i++;
+            continue;
+        }
+
+        m_slotOf.remove(entry.id);
+        expired.append(std::move(entry.callback));
+        entries.remove(i);
+    }
+
+    // A callback may start or cancel timers
+    for (const auto &callback : expired)
+        callback();
+}
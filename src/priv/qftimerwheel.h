@@ -0,0 +1,73 @@
+#ifndef QFTIMERWHEEL_H
+#define QFTIMERWHEEL_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QHash>
+#include <functional>
+
+/// QFTimerWheel runs many coarse one-shot timers on a single QTimer (Private class)
+/**
+  Timeouts are rounded up to the resolution and kept in a hashed wheel. Starting or cancelling
+  a timer does not allocate a QTimer, and the QTimer only runs while a timer is pending.
+  Each thread has its own wheel, and the callbacks are called by that thread.
+ */
+
+class QFTimerWheel : public QObject
+{
+    Q_OBJECT
+public:
+    enum {
+        // Milliseconds per tick
+        Resolution = 10,
+        SlotCount = 256
+    };
+
+    /// The wheel of the current thread. It is released with the thread.
+    static QFTimerWheel *local();
+
+    /// Call the callback once after msec milliseconds. Returns an id for cancel(), which is never 0.
+    int start(int msec, std::function<void()> callback);
+
+    void cancel(int id);
+
+    int pendingCount() const;
+
+private:
+    explicit QFTimerWheel(QObject *parent = nullptr);
+
+    void tick();
+
+    void advance();
+
+    struct Entry
+    {
+        int id;
+
+        // Remaining turns of the wheel before it fires
+        int rounds;
+
+        std::function<void()> callback;
+    };
+
+    QVector<QVector<Entry>> m_slots;
+
+    // Slot of a pending id
+    QHash<int, int> m_slotOf;
+
+    int m_cursor;
+    int m_nextId;
+
+    // Ticks advanced since m_clock is started
+    qint64 m_ticks;
+
+    // True while tick() runs the expired callbacks
+    bool m_ticking;
+
+    QElapsedTimer m_clock;
+    QTimer m_timer;
+};
+
+#endif // QFTIMERWHEEL_H
@@ -0,0 +1,134 @@
+#include <QtCore>
+#include <memory>
+#include "qftracebuffer.h"
+#include "qfactiontyperegistry.h"
+
+namespace {
+
+struct Buffers
+{
+    QMutex mutex;
+    std::vector<std::unique_ptr<QFTraceBuffer> > buffers;
+};
+
+Buffers &buffers()
+{
+    static Buffers instance;
+    return instance;
+}
+
+}
+
+QFTraceBuffer::QFTraceBuffer(quint64 threadId, const QString &threadName)
+    : m_next{0}
+    , m_wrapped{false}
+    , m_threadId{threadId}
+    , m_threadName{threadName}
+{
+}
+
+QFTraceBuffer *QFTraceBuffer::local()
+{
+    thread_local QFTraceBuffer *buffer = nullptr;
+
+    if (!buffer)
+    {
+        auto thread = QThread::currentThread();
+        auto app = QCoreApplication::instance();
+        auto name = thread->objectName();
+        if (name.isEmpty())
+            name = app && thread == app->thread() ? QStringLiteral("Main") : QStringLiteral("Thread");
+
+        buffer = new QFTraceBuffer(quint64(quintptr(QThread::currentThreadId())), name);
+
+        auto &data = buffers();
+        QMutexLocker locker(&data.mutex);
+        data.buffers.emplace_back(buffer);
+    }
+
+    return buffer;
+}
+
+void QFTraceBuffer::append(const Event &event)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_events.size() < Capacity)
+    {
+        m_events.append(event);
+        return;
+    }
+
+    m_events[m_next] = event;
+    m_next = (m_next + 1) % Capacity;
+    m_wrapped = true;
+}
+
+void QFTraceBuffer::clearAll()
+{
+    auto &data = buffers();
+    QMutexLocker locker(&data.mutex);
+
+    for (const auto &buffer : data.buffers)
+    {
+        QMutexLocker bufferLocker(&buffer->m_mutex);
+        buffer->m_events.clear();
+        buffer->m_next = 0;
+        buffer->m_wrapped = false;
+    }
+}
+
+QJsonArray QFTraceBuffer::exportAll(const QStringList &categories)
+{
+    const auto pid = double(QCoreApplication::applicationPid());
+    QJsonArray result;
+
+    auto &data = buffers();
+    QMutexLocker locker(&data.mutex);
+
+    for (const auto &buffer : data.buffers)
+    {
+        QMutexLocker bufferLocker(&buffer->m_mutex);
+
+        const auto tid = double(buffer->m_threadId);
+
+        result.append(QJsonObject{
+            {QStringLiteral("name"), QStringLiteral("thread_name")},
+            {QStringLiteral("ph"), QStringLiteral("M")},
+            {QStringLiteral("pid"), pid},
+            {QStringLiteral("tid"), tid},
+            {QStringLiteral("args"), QJsonObject{{QStringLiteral("name"), buffer->m_threadName}}}
+        });
+
+        // Oldest first
+        const auto count = buffer->m_events.size();
+        const auto first = buffer->m_wrapped ? buffer->m_next : 0;
+
+        for (int i = 0 ; i < count; i++)
+        {
+            const auto &event = buffer->m_events[(first + i) % count];
+            const auto category = categories.value(event.category);
+            const auto type = QFActionTypeRegistry::name(event.typeId);
+
+            QJsonObject object{
+                {QStringLiteral("name"), event.receiver.isEmpty() ? type : QStringLiteral("%1 (%2)").arg(event.receiver, type)},
+                {QStringLiteral("cat"), category},
+                {QStringLiteral("ph"), QString(QLatin1Char(event.phase))},
+                {QStringLiteral("ts"), event.start / 1000.0},
+                {QStringLiteral("pid"), pid},
+                {QStringLiteral("tid"), tid},
+                {QStringLiteral("args"), QJsonObject{{QStringLiteral("type"), type},
+                                                     {QStringLiteral("receiver"), event.receiver}}}
+            };
+
+            if (event.phase == 'X')
+                object.insert(QStringLiteral("dur"), event.duration / 1000.0);
+            else
+                object.insert(QStringLiteral("s"), QStringLiteral("t"));
+
+            result.append(object);
+        }
+    }
+
+    return result;
+}
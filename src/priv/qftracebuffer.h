@@ -0,0 +1,51 @@
+#ifndef QFTRACEBUFFER_H
+#define QFTRACEBUFFER_H
+
+#include <QString>
+#include <QVector>
+#include <QMutex>
+#include <QJsonArray>
+
+/// QFTraceBuffer keeps the latest trace events of a thread in a ring buffer (Private class)
+
+class QFTraceBuffer
+{
+public:
+    struct Event
+    {
+        // 'X' for a span, 'i' for an instant event
+        char phase = 'X';
+        int category = 0;
+        int typeId = 0;
+        qint64 start = 0;
+        qint64 duration = 0;
+        QString receiver;
+    };
+
+    /// The maximum number of events kept per thread. Older events are overwritten.
+    static const int Capacity = 1 << 16;
+
+    /// The buffer of the calling thread. It is created on first use and outlives the thread.
+    static QFTraceBuffer *local();
+
+    void append(const Event &event);
+
+    /// Discard the events of every thread
+    static void clearAll();
+
+    /// Convert the events of every thread to Chrome Trace Event objects
+    static QJsonArray exportAll(const QStringList &categories);
+
+private:
+    QFTraceBuffer(quint64 threadId, const QString &threadName);
+
+    QMutex m_mutex;
+    QVector<Event> m_events;
+    int m_next;
+    bool m_wrapped;
+
+    quint64 m_threadId;
+    QString m_threadName;
+};
+
+#endif // QFTRACEBUFFER_H
@@ -1,7 +1,69 @@
 #include <QtCore>
+#include <QtQml>
 #include <QQmlComponent>
 #include "qfappdispatcher.h"
 
+namespace {
+
+// Singleton objects resolved per engine. They are keyed by package, version and type name.
+using SingletonCache = QHash<QQmlEngine*, QHash<QString, QPointer<QObject> > >;
+
+SingletonCache &singletonCache()
+{
+    static SingletonCache cache;
+    return cache;
+}
+
+void insertCache(QQmlEngine *engine, const QString &key, QObject *object)
+{
+    auto &cache = singletonCache();
+
+    if (!cache.contains(engine))
+    {
+        QObject::connect(engine, &QObject::destroyed, [engine]() {
+            singletonCache().remove(engine);
+        });
+    }
+
+    cache[engine][key] = object;
+}
+
+QObject *createSingletonObject(QQmlEngine *engine, const QString &package, int versionMajor, int versionMinor, const QString &typeName)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,12,0)
+    // Resolve a registered singleton type directly without compiling any QML.
+    if (auto typeId = qmlTypeId(package.toUtf8().constData(), versionMajor, versionMinor, typeName.toUtf8().constData()); typeId >= 0)
+        if (auto object = engine->singletonInstance<QObject*>(typeId))
+            return object;
+#endif
+
+    auto pattern = QStringLiteral("import QtQuick 2.0\nimport %1 %2.%3;QtObject { property var object : %4 }");
+    auto qml = pattern.arg(package).arg(versionMajor).arg(versionMinor).arg(typeName);
+    auto comp = QQmlComponent{engine};
+    comp.setData(qml.toUtf8(), QUrl());
+    auto holder = comp.create();
+
+    if (!holder)
+    {
+        qWarning() << QStringLiteral("QuickFlux: Failed to gain singleton object: %1").arg(typeName);
+        qWarning() << QStringLiteral("Error: ") << comp.errorString();
+        return nullptr;
+    }
+
+    auto object = holder->property("object").value<QObject*>();
+    holder->deleteLater();
+
+    if (!object)
+    {
+        qWarning() << QStringLiteral("QuickFlux: Failed to gain singleton object: %1").arg(typeName);
+        qWarning() << QStringLiteral("Error: Unknown");
+    }
+
+    return object;
+}
+
+}
+
 /*!
    \qmltype AppDispatcher
    \inqmlmodule QuickFlux
@@ -45,31 +107,26 @@ QFAppDispatcher *QFAppDispatcher::instance(QQmlEngine *engine)
   Obtain a singleton object from a package for specific QQmlEngine instance.
   It is useful when you need to get a singleton Actions object from C++.
 
+  The result is cached per engine until the engine is destroyed.
+
  */
 
 QObject *QFAppDispatcher::singletonObject(QQmlEngine *engine, const QString &package, int versionMajor, int versionMinor, const QString &typeName)
 {
-    auto pattern = QStringLiteral("import QtQuick 2.0\nimport %1 %2.%3;QtObject { property var object : %4 }");
-    auto qml = pattern.arg(package).arg(versionMajor).arg(versionMinor).arg(typeName);
-    auto comp = QQmlComponent{engine};
-    comp.setData(qml.toUtf8(), QUrl());
-    auto holder = comp.create();
-
-    if (!holder)
-    {
-        qWarning() << QStringLiteral("QuickFlux: Failed to gain singleton object: %1").arg(typeName);
-        qWarning() << QStringLiteral("Error: ") << comp.errorString();
+    if (!engine)
         return nullptr;
-    }
 
-    auto object = holder->property("object").value<QObject*>();
-    holder->deleteLater();
+    auto key = QStringLiteral("%1/%2.%3/%4").arg(package).arg(versionMajor).arg(versionMinor).arg(typeName);
 
-    if (!object)
-    {
-        qWarning() << QStringLiteral("QuickFlux: Failed to gain singleton object: %1").arg(typeName);
-        qWarning() << QStringLiteral("Error: Unknown");
-    }
+    const auto &cache = singletonCache();
+    if (auto iter = cache.constFind(engine); iter != cache.cend())
+        if (auto object = iter.value().value(key).data())
+            return object;
+
+    auto object = createSingletonObject(engine, package, versionMajor, versionMinor, typeName);
+
+    if (object)
+        insertCache(engine, key, object);
 
     return object;
 }
@@ -7,6 +7,8 @@
 #include <QtCore>
 #include "qfappdispatcher.h"
 #include "qfapplistener.h"
+#include "priv/qfactiontyperegistry.h"
+#include "priv/qfactiontypepatterns.h"
 
 /*!
   \qmltype AppListener
@@ -122,6 +124,8 @@ void QFAppListener::setTarget(QFDispatcher *target)
 
         setListenerWaitFor();
 
+        setListenerTypes();
+
         connect(m_listener, &QFListener::dispatched, this, &QFAppListener::onMessageReceived);
     }
 }
@@ -135,14 +139,9 @@ void QFAppListener::setTarget(QFDispatcher *target)
 
 QFAppListener *QFAppListener::on(const QString &type, const QJSValue &callback)
 {
-    QVector<QJSValue> list;
-
-    if (mapping.contains(type))
-        list = mapping.value(type);
+    mapping[QFActionTypeRegistry::intern(type)].append(callback);
 
-    list.append(callback);
-
-    mapping[type] = list;
+    setListenerTypes();
 
     return this;
 }
@@ -154,11 +153,12 @@ QFAppListener *QFAppListener::on(const QString &type, const QJSValue &callback)
 
 void QFAppListener::removeListener(const QString &type, const QJSValue &callback)
 {
-    if (!mapping.contains(type))
+    auto typeId = QFActionTypeRegistry::lookup(type);
+    if (!mapping.contains(typeId))
         return;
 
     QVector<QJSValue> list;
-    list = mapping[type];
+    list = mapping[typeId];
 
     auto index = -1;
     for (auto i = 0 ; i < list.size() ;i++)
@@ -173,8 +173,10 @@ void QFAppListener::removeListener(const QString &type, const QJSValue &callback
     if (index >=0 )
     {
         list.removeAt(index);
-        mapping[type] = list;
+        mapping[typeId] = list;
     }
+
+    setListenerTypes();
 }
 
 /*! \qmlmethod AppListener::removeAllListener(string type)
@@ -186,7 +188,9 @@ void QFAppListener::removeAllListener(const QString &type)
     if (type.isEmpty())
         mapping.clear();
     else
-        mapping.remove(type);
+        mapping.remove(QFActionTypeRegistry::lookup(type));
+
+    setListenerTypes();
 }
 
 void QFAppListener::componentComplete()
@@ -202,38 +206,21 @@ void QFAppListener::componentComplete()
         setTarget(dispatcher);
 }
 
-void QFAppListener::onMessageReceived(const QString &type, const QJSValue &message)
+void QFAppListener::onMessageReceived(const QString &type, const QJSValue &message, int typeId)
 {
     if (!isEnabled() && !m_alwaysOn)
         return;
 
-    auto dispatch = true;
-
-    auto rules = m_filters;
-    if (!m_filter.isEmpty())
-        rules.append(m_filter);
-
-    if (!rules.empty())
-    {
-        dispatch = false;
-        for (const auto &rule : rules)
-        {
-            if (type == rule)
-            {
-                dispatch = true;
-                break;
-            }
-        }
-    }
-
-    if (dispatch)
+    if ((m_filterIds.empty() && m_filterPatternIds.empty()) ||
+        m_filterIds.contains(typeId) ||
+        QFActionTypePatterns::matches(m_filterPatternIds, typeId))
         emit dispatched(type,message);
 
     // Listener registered with on() should not be affected by filter.
-    if (!mapping.contains(type))
+    if (!mapping.contains(typeId))
         return;
 
-    auto list = mapping.value(type);
+    auto list = mapping.value(typeId);
 
     QVector<QJSValue> arguments;
     arguments << message;
@@ -251,6 +238,32 @@ void QFAppListener::setListenerWaitFor()
     m_listener->setWaitFor(m_waitFor);
 }
 
+void QFAppListener::setListenerTypes()
+{
+    auto rules = m_filters;
+    if (!m_filter.isEmpty())
+        rules.append(m_filter);
+
+    QFActionTypePatterns::compile(rules, m_filterIds, m_filterPatternIds);
+
+    if (!m_listener)
+        return;
+
+    // Without any filter rule, the dispatched signal is emitted for every message.
+    if (rules.empty())
+    {
+        m_listener->clearTypes();
+        return;
+    }
+
+    for (auto iter = mapping.cbegin(); iter != mapping.cend(); ++iter)
+        if (!iter.value().empty())
+            rules.append(QFActionTypeRegistry::name(iter.key()));
+
+    rules.removeDuplicates();
+    m_listener->setTypes(rules);
+}
+
 /*! \qmlproperty array AppListener::waitFor
 
 If it is set, it will block the emission of dispatched signal until all the specificed listeners has been invoked.
@@ -268,6 +281,9 @@ AppListener {
 }
 \endcode
 
+The dispatcher sorts the listeners by their waitFor declarations whenever they change, not on every action.
+A cyclic dependency is reported when the waitFor declaration that makes it is set.
+
  */
 
 QVector<int> QFAppListener::waitFor() const
@@ -320,6 +336,9 @@ void QFAppListener::setAlwaysOn(bool alwaysOn)
   Set a list of filter to incoming messages. Only message with type matched by the filters will emit "dispatched" signal.
   If it is not set, it will dispatch every message.
 
+  A filter may be a pattern with wildcards, e.g. "photo/*". "*" matches any sequence of characters and "?" matches a single character.
+  An action type that contains "*" or "?" literally is matched exactly only if they are escaped by a backslash, e.g. "rate\\*" in QML.
+
  */
 
 QStringList QFAppListener::filters() const
@@ -330,6 +349,7 @@ QStringList QFAppListener::filters() const
 void QFAppListener::setFilters(const QStringList &filters)
 {
     m_filters = filters;
+    setListenerTypes();
     emit filtersChanged();
 }
 
@@ -347,5 +367,6 @@ QString QFAppListener::filter() const
 void QFAppListener::setFilter(const QString &filter)
 {
     m_filter = filter;
+    setListenerTypes();
     emit filterChanged();
 }
@@ -6,7 +6,7 @@
 #include <QPointer>
 #include <QQuickItem>
 #include <QQmlParserStatus>
-#include <QMap>
+#include <QHash>
 #include "priv/qflistener.h"
 #include "qfdispatcher.h"
 
@@ -79,16 +79,23 @@ public slots:
 private:
     virtual void componentComplete();
 
-    Q_INVOKABLE void onMessageReceived(const QString &name, const QJSValue &message);
+    void onMessageReceived(const QString &type, const QJSValue &message, int typeId);
 
     void setListenerWaitFor();
 
+    void setListenerTypes();
+
     QPointer<QFDispatcher> m_target;
 
-    QMap<QString,QVector<QJSValue>>  mapping;
+    // Callbacks registered by on(), indexed by the id of action type
+    QHash<int,QVector<QJSValue>>  mapping;
 
     QString m_filter;
     QStringList m_filters;
+
+    // Interned ids of filter and filters, and the ids of the wildcard patterns among them
+    QVector<int> m_filterIds;
+    QVector<int> m_filterPatternIds;
     bool m_alwaysOn;
 
     int m_listenerId;
@@ -31,6 +31,9 @@ void QFAppListenerGroup::componentComplete()
     auto dispatcher = QFAppDispatcher::instance(engine);
 
     m_listener = new QFListener(this);
+
+    // The group listener only serves as a waitFor anchor for its children. It never handles a message by itself.
+    m_listener->setTypes(QStringList());
     m_listenerId = dispatcher->addListener(m_listener);
     setListenerWaitFor();
 
@@ -5,6 +5,8 @@
 #include <QtCore>
 #include "qfappscript.h"
 #include "qfapplistener.h"
+#include "priv/qfactiontyperegistry.h"
+#include "priv/qfactiontypepatterns.h"
 
 /*! \qmltype AppScript
     \inqmlmodule QuickFlux
@@ -95,6 +97,7 @@ AppScript::run() / AppScript::exit() clear all the registered callback completel
 
 QFAppScript::QFAppScript(QQuickItem *parent)
     : QQuickItem(parent)
+      , m_runWhenId{0}
       , m_running{false}
       , m_processing{false}
       , m_listenerId{0}
@@ -205,6 +208,7 @@ QFAppScriptRunnable *QFAppScript::once(const QJSValue &condition, const QJSValue
     runnable->setCondition(condition);
     runnable->setScript(script);
     m_runnables.append(runnable);
+    setListenerTypes();
     return runnable;
 }
 
@@ -222,10 +226,12 @@ void QFAppScript::on(const QJSValue &condition, const QJSValue &script)
     runnable->setIsOnceOnly(false);
 }
 
-void QFAppScript::onDispatched(const QString &type, const QJSValue &message)
+void QFAppScript::onDispatched(const QString &type, const QJSValue &message, int typeId)
 {
+    Q_UNUSED(type);
+
     if (!m_runWhen.isEmpty() &&
-        type == m_runWhen &&
+        (typeId == m_runWhenId || QFActionTypePatterns::matches(m_runWhenPatternIds, typeId)) &&
         !m_processing) {
 
         if (m_running) {
@@ -245,7 +251,7 @@ void QFAppScript::onDispatched(const QString &type, const QJSValue &message)
     QVector<int> marked;
 
     for (auto i = 0 ; i < m_runnables.size() ; i++) {
-        if (m_runnables.at(i)->type() == type) {
+        if (m_runnables.at(i)->typeId() == typeId) {
             m_runnables.at(i)->run(message);
 
             if (!m_running) {
@@ -280,6 +286,10 @@ void QFAppScript::onDispatched(const QString &type, const QJSValue &message)
 
     m_processing = false;
 
+    if (!marked.isEmpty()) {
+        setListenerTypes();
+    }
+
     // All the tasks are finished
     if (m_runnables.empty() && m_autoExit) {
         exit(0);
@@ -298,10 +308,15 @@ void QFAppScript::componentComplete()
 
     m_listener = new QFListener(this);
 
+    // A new listener catches every action until it is given the types
+    m_listener->setTypes(m_listenerTypes);
+
     setListenerId(m_dispatcher->addListener(m_listener));
 
     setListenerWaitFor();
 
+    setListenerTypes();
+
     connect(m_listener, &QFListener::dispatched,
             this, &QFAppScript::onDispatched);
 }
@@ -314,9 +329,15 @@ void QFAppScript::abort()
 void QFAppScript::clear()
 {
     for (const auto &runnable : m_runnables) {
+        // Disconnect the chained signal conditions now, so their types are
+        // free for the next run
+        for (auto chained = runnable ; chained ; chained = chained->next()) {
+            chained->release();
+        }
         runnable->deleteLater();
     }
     m_runnables.clear();
+    setListenerTypes();
 }
 
 /*! \qmlproperty bool AppScript::running
@@ -361,6 +382,36 @@ void QFAppScript::setListenerWaitFor()
     m_listener->setWaitFor(m_waitFor);
 }
 
+void QFAppScript::setListenerTypes()
+{
+    if (!m_listener) {
+        return;
+    }
+
+    // Only runWhen and the conditions of registered callbacks are relevant to AppScript
+    QStringList types;
+
+    if (!m_runWhen.isEmpty()) {
+        types << m_runWhen;
+    }
+
+    for (const auto &runnable : m_runnables) {
+        if (!runnable->type().isEmpty()) {
+            types << runnable->type();
+        }
+    }
+
+    types.removeDuplicates();
+
+    // Re-registering the listener is not free, skip it if nothing changed
+    if (types == m_listenerTypes) {
+        return;
+    }
+
+    m_listenerTypes = types;
+    m_listener->setTypes(types);
+}
+
 bool QFAppScript::autoExit() const
 {
     return m_autoExit;
@@ -399,6 +450,8 @@ void QFAppScript::setMessage(const QJSValue &message)
    This property hold a string of message type.
    Whatever a dispatched message matched, it will trigger to call run() immediately.
 
+   It may be a pattern with wildcards, e.g. "photo/*". Escape "*" and "?" by a backslash to match them literally.
+
  */
 
 QString QFAppScript::runWhen() const
@@ -409,6 +462,15 @@ QString QFAppScript::runWhen() const
 void QFAppScript::setRunWhen(const QString &runWhen)
 {
     m_runWhen = runWhen;
+    m_runWhenId = 0;
+    m_runWhenPatternIds.clear();
+
+    if (QFActionTypePatterns::isPattern(runWhen))
+        m_runWhenPatternIds << QFActionTypePatterns::compile(runWhen);
+    else if (!runWhen.isEmpty())
+        m_runWhenId = QFActionTypeRegistry::intern(QFActionTypePatterns::unescape(runWhen));
+
+    setListenerTypes();
     emit runWhenChanged();
 }
 
@@ -64,7 +64,7 @@ public slots:
     void on(const QJSValue &condition, const QJSValue &script);
 
 private slots:
-    void onDispatched(const QString &type, const QJSValue &message);
+    void onDispatched(const QString &type, const QJSValue &message, int typeId);
 
 private:
     virtual void componentComplete();
@@ -74,10 +74,16 @@ private:
 
     void setListenerWaitFor();
 
+    void setListenerTypes();
+
     QQmlScriptString m_script;
     QVector<QFAppScriptRunnable*> m_runnables;
     QPointer<QFAppDispatcher> m_dispatcher;
     QString m_runWhen;
+    int m_runWhenId;
+
+    // Set if runWhen is a wildcard pattern
+    QVector<int> m_runWhenPatternIds;
 
     bool m_running;
     bool m_processing;
@@ -90,6 +96,9 @@ private:
     QJSValue m_message;
     QFListener* m_listener;
 
+    // The types last passed to m_listener
+    QStringList m_listenerTypes;
+
     QVector<int> m_waitFor;
 };
 
@@ -1,11 +1,26 @@
 #include <QtCore>
-#include <QUuid>
 #include <QFAppDispatcher>
 #include "priv/qfappscriptrunnable.h"
 #include "priv/qfappscriptdispatcherwrapper.h"
+#include "priv/qfactiontyperegistry.h"
+
+// Every signal condition dispatches a type of its own, so the action is only
+// delivered to the AppScript waiting for it. The registry never frees an id,
+// hence the types of released conditions are reused.
+static QStringList signalConditionTypePool;
+static int signalConditionTypeCount = 0;
+
+static QString acquireSignalConditionType()
+{
+    if (!signalConditionTypePool.isEmpty()) {
+        return signalConditionTypePool.takeFirst();
+    }
+    return QStringLiteral("QuickFlux.AppScript.Signal.%1").arg(signalConditionTypeCount++);
+}
 
 QFAppScriptRunnable::QFAppScriptRunnable(QObject *parent)
     : QObject(parent)
+      , m_typeId{0}
       , m_next{}
       , m_isSignalCondition{false}
       , m_isOnceOnly{true}
@@ -32,9 +47,15 @@ QString QFAppScriptRunnable::type() const
     return m_type;
 }
 
+int QFAppScriptRunnable::typeId() const
+{
+    return m_typeId;
+}
+
 void QFAppScriptRunnable::setType(const QString &type)
 {
     m_type = type;
+    m_typeId = QFActionTypeRegistry::intern(type);
 }
 
 bool QFAppScriptRunnable::isOnceOnly() const
@@ -64,6 +85,13 @@ void QFAppScriptRunnable::release()
 
     m_condition = QJSValue();
     m_callback = QJSValue();
+
+    if (m_isSignalCondition && !m_type.isEmpty()) {
+        // Disconnected, so nothing dispatches this type any more
+        signalConditionTypePool.append(m_type);
+        m_type.clear();
+        m_typeId = 0;
+    }
 }
 
 void QFAppScriptRunnable::run(const QJSValue &message)
@@ -126,7 +154,7 @@ void QFAppScriptRunnable::setCondition(const QJSValue &condition)
     {
         Q_ASSERT(!m_engine.isNull());
 
-        auto type = QStringLiteral("QuickFlux.AppScript.%1").arg(QUuid::createUuid().toString());
+        const auto type = acquireSignalConditionType();
         setType(type);
 
         auto generator = QStringLiteral("function(dispatcher) { return function() {dispatcher.dispatch(arguments)}}");
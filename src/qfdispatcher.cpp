@@ -3,7 +3,11 @@
 #include <QVariant>
 #include <QJSValue>
 #include <QPointer>
+#include <algorithm>
 #include "priv/quickfluxfunctions.h"
+#include "priv/qfactiontyperegistry.h"
+#include "priv/qfactiontypepatterns.h"
+#include "priv/qfprofilerscope.h"
 #include "qfdispatcher.h"
 
 struct DispatchingGuard
@@ -23,6 +27,15 @@ private:
     bool &m_dispatching;
 };
 
+namespace {
+
+// A listener id is (generation << SlotBits) | (slot + 1). It is always positive.
+const int SlotBits = 20;
+const int SlotMask = (1 << SlotBits) - 1;
+const int GenerationMask = 0x7ff;
+
+}
+
 /*!
    \qmltype Dispatcher
    \inqmlmodule QuickFlux
@@ -120,8 +133,16 @@ Connections {
 QFDispatcher::QFDispatcher(QObject *parent)
     : QObject{parent}
       , m_dispatching{false}
-      , m_nextListenerId{1}
+      , m_hookDispatching{false}
+      , m_starvationLimit{8}
+      , m_batched{false}
+      , m_batching{false}
+      , m_flushPending{false}
+      , m_nextSequence{0}
       , m_dispatchingListenerId{}
+      , m_dispatchingMessageTypeId{}
+      , m_nextSubscriptionId{1}
+      , m_inboxWakePending{false}
 {
 }
 
@@ -158,28 +179,288 @@ void QFDispatcher::dispatch(const QString &type, const QJSValue &message)
 {
     QF_PRECHECK_DISPATCH(m_engine.data(), type, message);
 
-    auto process = [this](const auto &type, const auto &message) {
-        if (m_hook.isNull())
-            send(type, message);
-        else
-            m_hook->dispatch(type, message);
-    };
+    post(QFActionEnvelope(type, message));
+}
 
+void QFDispatcher::post(const QFActionEnvelope &envelope)
+{
     if (m_dispatching)
     {
-        m_queue.enqueue(qMakePair(type, message));
+        // A reentrant dispatch. It waits until the current action is delivered.
+        enqueue(envelope);
+        return;
+    }
+
+    if (m_batched)
+    {
+        enqueue(envelope);
+        scheduleFlush();
         return;
     }
 
     DispatchingGuard dispatchingGuard(m_dispatching);
 
-    process(type, message);
+    auto current = envelope;
+    process(current);
+
+    drainQueue();
+}
+
+void QFDispatcher::enqueue(QFActionEnvelope envelope)
+{
+    const auto typeId = envelope.typeId();
+    const auto laneIndex = m_laneOfType.isEmpty() ? int(NormalLane) : m_laneOfType.value(typeId, NormalLane);
+    auto &lane = m_lanes[laneIndex];
+
+    envelope.setPostedAt(QFProfiler::now());
+    lane.queue.enqueue(std::move(envelope));
+    lane.maxDepth = qMax(lane.maxDepth, lane.queue.size());
+
+    if (QFProfiler::isActive())
+        QFProfiler::instance()->mark(QFProfiler::Queue, this, typeId);
+
+    if (m_coalescing.isEmpty())
+        return;
+
+    auto &queued = lane.queue.last();
+    const auto policy = m_coalescing.constFind(typeId);
+    if (policy == m_coalescing.cend())
+        return;
+
+    // Latest wins. The superseded action is squashed before it reaches the hook and listeners.
+    const auto position = qMakePair(laneIndex, lane.dequeued + lane.queue.size() - 1);
+    const auto key = qMakePair(typeId, coalescingKey(queued, policy.value()));
+
+    if (auto latest = m_coalescedPositions.find(key); latest != m_coalescedPositions.end())
+    {
+        const auto &previous = m_lanes[latest.value().first];
+
+        if (latest.value().second >= previous.dequeued)
+        {
+            m_lanes[latest.value().first].queue[int(latest.value().second - previous.dequeued)] = QFActionEnvelope();
+            m_squashed[typeId]++;
+        }
+
+        latest.value() = position;
+        return;
+    }
+
+    m_coalescedPositions.insert(key, position);
+}
+
+void QFDispatcher::drainQueue()
+{
+    QFActionEnvelope current;
+
+    while (takeQueued(current))
+        if (current.typeId() != 0)
+            process(current);
+
+    m_coalescedPositions.clear();
+}
+
+bool QFDispatcher::isQueueEmpty() const
+{
+    for (const auto &lane : m_lanes)
+        if (!lane.queue.isEmpty())
+            return false;
+
+    return true;
+}
+
+bool QFDispatcher::takeQueued(QFActionEnvelope &envelope)
+{
+    int chosen = -1;
+
+    // A lower lane skipped too many times goes first
+    for (int i = LaneCount - 1 ; i > 0 && m_starvationLimit > 0; i--)
+    {
+        if (!m_lanes[i].queue.isEmpty() && m_lanes[i].skipped >= m_starvationLimit)
+        {
+            chosen = i;
+            break;
+        }
+    }
+
+    for (int i = 0 ; i < LaneCount && chosen < 0; i++)
+        if (!m_lanes[i].queue.isEmpty())
+            chosen = i;
+
+    if (chosen < 0)
+        return false;
+
+    for (int i = chosen + 1 ; i < LaneCount; i++)
+        if (!m_lanes[i].queue.isEmpty())
+            m_lanes[i].skipped++;
+
+    auto &lane = m_lanes[chosen];
+    lane.skipped = 0;
+    lane.dequeued++;
+    envelope = lane.queue.dequeue();
+
+    // Squashed actions are not counted
+    if (envelope.typeId() != 0)
+    {
+        const auto wait = QFProfiler::now() - envelope.postedAt();
+        lane.delivered++;
+        lane.totalWait += wait;
+        lane.maxWait = qMax(lane.maxWait, wait);
+    }
+
+    return true;
+}
+
+/*!
+  \qmlmethod Dispatcher::setLane(string type, Lane lane)
+
+  Place the queued actions of \a type in a priority lane. When the dispatcher is busy, new actions wait in a queue.
+  The actions in a higher lane are delivered first, and those in the same lane keep their order.
+
+  \list
+  \li Dispatcher.InputLane - User input that should not wait for the others.
+  \li Dispatcher.NormalLane - The default lane.
+  \li Dispatcher.BackgroundLane - Telemetry, logging, etc.
+  \endlist
+
+  \code
+
+  AppDispatcher.setLane(ActionTypes.clickItem, Dispatcher.InputLane);
+  AppDispatcher.setLane(ActionTypes.trackEvent, Dispatcher.BackgroundLane);
+
+  \endcode
+
+  A lower lane is not starved. After starvationLimit actions are taken from higher lanes while it is waiting,
+  its next action goes first.
+
+  \sa laneMetrics
+ */
+
+void QFDispatcher::setLane(const QString &type, int lane)
+{
+    const auto typeId = QFActionTypeRegistry::intern(type);
+
+    if (lane < InputLane || lane > BackgroundLane)
+    {
+        qWarning() << "Dispatcher.setLane(): Invalid lane" << lane;
+        return;
+    }
+
+    if (lane == NormalLane)
+        m_laneOfType.remove(typeId);
+    else
+        m_laneOfType.insert(typeId, lane);
+}
+
+int QFDispatcher::lane(const QString &type) const
+{
+    return m_laneOfType.value(QFActionTypeRegistry::lookup(type), NormalLane);
+}
+
+/*!
+  \qmlmethod array Dispatcher::laneMetrics()
+
+  Returns the metrics of the priority lanes, one object per lane with the following properties.
+
+  \list
+  \li lane - "input", "normal" or "background"
+  \li depth - The number of actions waiting
+  \li maxDepth - The maximum number of actions waiting at the same time
+  \li delivered - The number of actions taken from the lane
+  \li averageWait - The average time spent in the queue, in microseconds
+  \li maxWait - The maximum time spent in the queue, in microseconds
+  \endlist
+ */
+
+QVariantList QFDispatcher::laneMetrics() const
+{
+    static const char *names[] = {"input", "normal", "background"};
+
+    QVariantList result;
+
+    for (int i = 0 ; i < LaneCount; i++)
+    {
+        const auto &lane = m_lanes[i];
+
+        QVariantMap metrics;
+        metrics["lane"] = QString(names[i]);
+        metrics["depth"] = lane.queue.size();
+        metrics["maxDepth"] = lane.maxDepth;
+        metrics["delivered"] = lane.delivered;
+        metrics["averageWait"] = lane.delivered > 0 ? double(lane.totalWait) / lane.delivered / 1000.0 : 0.0;
+        metrics["maxWait"] = double(lane.maxWait) / 1000.0;
+        result << metrics;
+    }
+
+    return result;
+}
+
+/*!
+  \qmlmethod Dispatcher::resetLaneMetrics()
+
+  Clear the metrics returned by laneMetrics()
+ */
+
+void QFDispatcher::resetLaneMetrics()
+{
+    for (auto &lane : m_lanes)
+    {
+        lane.maxDepth = lane.queue.size();
+        lane.delivered = 0;
+        lane.totalWait = 0;
+        lane.maxWait = 0;
+    }
+}
+
+/*!
+  \qmlproperty int Dispatcher::starvationLimit
+
+  The number of actions taken from higher lanes before a waiting action of a lower lane is delivered.
+  If it is zero, the lower lanes wait until the higher lanes are empty.
+
+  The default value is 8
+ */
+
+int QFDispatcher::starvationLimit() const
+{
+    return m_starvationLimit;
+}
+
+void QFDispatcher::setStarvationLimit(int starvationLimit)
+{
+    if (m_starvationLimit == starvationLimit)
+        return;
+
+    m_starvationLimit = starvationLimit;
+    emit starvationLimitChanged();
+}
+
+QString QFDispatcher::coalescingKey(QFActionEnvelope &envelope, const QString &key)
+{
+    if (key.isEmpty())
+        return QString();
+
+    if (envelope.isNative())
+        return envelope.variant().toMap().value(key).toString();
+
+    return envelope.message(m_engine.data()).property(key).toString();
+}
 
-    while (!m_queue.empty())
+void QFDispatcher::process(QFActionEnvelope &envelope)
+{
+    if (envelope.postedAt() >= 0 && QFProfiler::isActive())
+        QFProfiler::instance()->span(QFProfiler::Queue, this, envelope.typeId(), envelope.postedAt(), QFProfiler::now());
+
+    if (m_hook.isNull() || envelope.isHooked())
     {
-        auto pair = m_queue.dequeue();
-        process(pair.first, pair.second);
+        deliver(envelope);
+        return;
     }
+
+    // The hook decides whether the message needs to be converted
+    QScopedValueRollback<bool> hookDispatching(m_hookDispatching, true);
+
+    m_hookEnvelope = envelope;
+    m_hook->dispatchEnvelope(envelope, m_engine.data());
 }
 
 /*!
@@ -196,9 +477,13 @@ void QFDispatcher::waitFor(const QVector<int> &ids)
     if (!m_dispatching || ids.empty())
         return;
 
-    m_waitingListeners[m_dispatchingListenerId] = true;
+    const auto slot = slotOf(m_dispatchingListenerId);
+    if (slot < 0)
+        return;
+
+    m_waitingListeners.setBit(slot);
     invokeListeners(ids);
-    m_waitingListeners.remove(m_dispatchingListenerId);
+    m_waitingListeners.clearBit(slot);
 }
 
 /*!
@@ -225,9 +510,50 @@ int QFDispatcher::addListener(const QJSValue &callback)
  */
 int QFDispatcher::addListener(QFListener *listener)
 {
-    m_listeners[m_nextListenerId] = listener;
-    listener->setListenerId(m_nextListenerId);
-    return m_nextListenerId++;
+    int slot;
+
+    if (!m_freeSlots.isEmpty())
+    {
+        slot = m_freeSlots.takeLast();
+    }
+    else
+    {
+        slot = m_slots.size();
+        m_slots.append(ListenerSlot());
+        m_pendingListeners.resize(m_slots.size());
+        m_waitingListeners.resize(m_slots.size());
+        m_visitedListeners.resize(m_slots.size());
+    }
+
+    auto &entry = m_slots[slot];
+    entry.listener = listener;
+    entry.sequence = m_nextSequence++;
+
+    const auto id = idOf(slot);
+    listener->setListenerId(id);
+    indexListener(slot);
+
+    connect(listener, &QFListener::typesChanged, this, [this, id]() {
+        if (auto current = slotOf(id); current >= 0)
+            reindexListener(current);
+    });
+
+    connect(listener, &QFListener::waitForChanged, this, [this, id]() {
+        m_schedules.clear();
+
+        if (auto current = slotOf(id); current >= 0)
+            checkCycles(current);
+    });
+
+    m_schedules.clear();
+    checkCycles(slot);
+
+    connect(listener, &QObject::destroyed, this, [this, id]() {
+        if (auto current = slotOf(id); current >= 0)
+            releaseListener(current);
+    });
+
+    return id;
 }
 
 /*!
@@ -239,13 +565,74 @@ int QFDispatcher::addListener(QFListener *listener)
 
 void QFDispatcher::removeListener(int id)
 {
-    if (m_listeners.contains(id))
+    const auto slot = slotOf(id);
+    if (slot < 0)
+        return;
+
+    if (auto listener = m_slots[slot].listener.data(); listener)
     {
-        if (auto listener = m_listeners.value(id).data(); listener->parent() == this)
-            listener->deleteLater();
+        listener->disconnect(this);
 
-        m_listeners.remove(id);
+        if (listener->parent() == this)
+            listener->deleteLater();
     }
+
+    releaseListener(slot);
+}
+
+/*!
+  \qmlmethod Dispatcher::setCoalescing(string type, string key)
+
+  Coalesce the actions of \a type waiting in the queue. When an action is dispatched while the dispatcher is still busy,
+  it is placed on a queue. If a queued action of the same type has not been delivered yet, it is superseded by the new one
+  and dropped before it reaches middlewares or listeners. Only the latest one is delivered.
+
+  If \a key is given, only the actions with the same value of this property in the message supersede each other.
+
+  \code
+
+  AppDispatcher.setCoalescing(ActionTypes.scrollTo);
+  AppDispatcher.setCoalescing(ActionTypes.sensorUpdated, "sensorId");
+
+  \endcode
+
+  Actions dispatched by dispatchFromAnyThread() are queued in batches, so they are coalesced too.
+
+  \sa removeCoalescing, squashedCount
+ */
+
+void QFDispatcher::setCoalescing(const QString &type, const QString &key)
+{
+    m_coalescing.insert(QFActionTypeRegistry::intern(type), key);
+}
+
+/*!
+  \qmlmethod Dispatcher::removeCoalescing(string type)
+
+  Deliver every action of \a type again. The number of squashed actions is kept.
+ */
+
+void QFDispatcher::removeCoalescing(const QString &type)
+{
+    m_coalescing.remove(QFActionTypeRegistry::intern(type));
+}
+
+/*!
+  \qmlmethod int Dispatcher::squashedCount(string type)
+
+  The number of actions of \a type dropped by coalescing. If type is omitted, it returns the total of all types.
+ */
+
+int QFDispatcher::squashedCount(const QString &type) const
+{
+    if (!type.isEmpty())
+        return m_squashed.value(QFActionTypeRegistry::lookup(type));
+
+    int count = 0;
+    for (auto value : m_squashed)
+        count += value;
+
+    return count;
 }
 
 
@@ -255,61 +642,644 @@ void QFDispatcher::removeListener(int id)
   The message will be placed on a queue and delivery via the "dispatched" signal.
   Listeners may listen on the "dispatched" signal directly,
   or using helper components like AppListener / AppScript to capture signal.
+
+  The message is converted to a QJSValue only if a listener, a middleware or a
+  connection to the "dispatched" signal needs it. Callbacks registered by subscribe()
+  receive the original QVariant.
  */
 
 void QFDispatcher::dispatch(const QString &type, const QVariant &message)
 {
-    if (m_engine.isNull())
+    post(QFActionEnvelope(type, message));
+}
+
+/*! \fn QFSubscription QFAppDispatcher::subscribe(const QString& type, std::function<void(const QVariant&)> callback)
+
+  Register a C++ \a callback to be invoked with the message of every action of \a type.
+  It is called after the listeners of the dispatcher, and before the "dispatched" signal.
+
+  The subscription lasts until the returned handle is destroyed or unsubscribed.
+  It must be used by the thread owning the dispatcher.
+ */
+
+QFSubscription QFDispatcher::subscribe(const QString &type, std::function<void(const QVariant &)> callback)
+{
+    const auto typeId = QFActionTypeRegistry::intern(type);
+    const auto id = m_nextSubscriptionId++;
+
+    m_subscribers[typeId].append(Subscriber{id, std::move(callback)});
+    m_subscriptionTypes.insert(id, typeId);
+
+    return QFSubscription(this, id);
+}
+
+void QFDispatcher::unsubscribe(int id)
+{
+    auto iter = m_subscriptionTypes.find(id);
+    if (iter == m_subscriptionTypes.end())
+        return;
+
+    const auto typeId = iter.value();
+    m_subscriptionTypes.erase(iter);
+
+    auto &subscribers = m_subscribers[typeId];
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [id](const Subscriber &subscriber) {
+        return subscriber.id == id;
+    }), subscribers.end());
+
+    if (subscribers.isEmpty())
+        m_subscribers.remove(typeId);
+}
+
+/*! \fn QFAppDispatcher::dispatchFromAnyThread(const QString& type, const QVariant& message)
+
+  Dispatch a message with type from any thread. It is thread-safe.
+
+  The message is placed on a lock-free queue and dispatched later by the thread owning the
+  dispatcher. All the messages posted before the thread wakes up are dispatched in a single batch,
+  and the conversion from QVariant to QJSValue also happens on the owner thread.
+
+  Messages posted by the same thread are dispatched in the order they were posted.
+  The dispatcher must outlive the threads calling this function.
+ */
+
+void QFDispatcher::dispatchFromAnyThread(const QString &type, const QVariant &message)
+{
+    m_inbox.push(qMakePair(type, message));
+
+    // Only the first message after a drain schedules a wake up.
+    if (!m_inboxWakePending.exchange(true, std::memory_order_acq_rel))
+        QMetaObject::invokeMethod(this, [this]() { drainInbox(); }, Qt::QueuedConnection);
+}
+
+void QFDispatcher::drainInbox()
+{
+    // Reset the flag before draining, so a message pushed during the drain schedules another wake up.
+    m_inboxWakePending.store(false, std::memory_order_release);
+
+    QPair<QString, QVariant> action;
+
+    if (m_dispatching)
     {
-        qWarning() << "QFAppDispatcher::dispatch() - Unexpected error: engine is not available.";
+        while (m_inbox.pop(action))
+            enqueue(QFActionEnvelope(action.first, action.second));
         return;
     }
 
-    auto value = m_engine->toScriptValue<QVariant>(message);
+    // Queue the batch first, so coalesced actions in it are squashed
+    DispatchingGuard dispatchingGuard(m_dispatching);
+
+    while (m_inbox.pop(action))
+        enqueue(QFActionEnvelope(action.first, action.second));
 
-    dispatch(type, value);
+    if (m_batched)
+        scheduleFlush();
+    else
+        drainQueue();
 }
 
+/*!
+  \qmlproperty bool Dispatcher::batched
+
+  If it is true, the dispatcher does not deliver an action immediately. Actions are accumulated and delivered
+  together once per frame of the window, or in the next iteration of the event loop if the window is not set.
+  Actions dispatched by listeners during the batch are delivered in the same batch.
+
+  After a batch, the batchDispatched signal is emitted with the list of actions. A Store with batchEnabled
+  receives the whole batch at once.
+
+  \code
+
+  Dispatcher {
+    batched: true
+    window: applicationWindow
+  }
+
+  \endcode
+
+  The default value is false
+ */
+
+bool QFDispatcher::isBatched() const
+{
+    return m_batched;
+}
+
+void QFDispatcher::setBatched(bool batched)
+{
+    if (m_batched == batched)
+        return;
+
+    m_batched = batched;
+
+    // Deliver the pending actions right away
+    if (!m_batched)
+        flush();
+
+    emit batchedChanged();
+}
+
+/*!
+  \qmlproperty Window Dispatcher::window
+
+  The window a batch is aligned to. In batched mode, actions are delivered when the window starts a new frame,
+  right after the animations are advanced. If it is null, a zero-interval timer is used.
+ */
+
+QQuickWindow *QFDispatcher::window() const
+{
+    return m_window;
+}
+
+void QFDispatcher::setWindow(QQuickWindow *window)
+{
+    if (m_window.data() == window)
+        return;
+
+    if (!m_window.isNull())
+        m_window->disconnect(this);
+
+    m_window = window;
+
+    // afterAnimating is emitted by the GUI thread before the scene graph is synchronized
+    if (!m_window.isNull())
+        connect(m_window.data(), &QQuickWindow::afterAnimating, this, &QFDispatcher::flush);
+
+    emit windowChanged();
+}
+
+bool QFDispatcher::isBatching() const
+{
+    return m_batching;
+}
+
+/*!
+  \qmlmethod Dispatcher::flush()
+
+  Deliver the actions accumulated in batched mode immediately.
+ */
+
+void QFDispatcher::flush()
+{
+    m_flushPending = false;
+
+    if (m_dispatching || isQueueEmpty())
+        return;
+
+    static const auto batchDispatchedSignal = QMetaMethod::fromSignal(&QFDispatcher::batchDispatched);
+    const auto collect = isSignalConnected(batchDispatchedSignal);
+
+    {
+        DispatchingGuard dispatchingGuard(m_dispatching);
+
+        m_batching = collect;
+        drainQueue();
+        m_batching = false;
+    }
+
+    if (!collect || m_batchDelivered.isEmpty() || m_engine.isNull())
+    {
+        m_batchDelivered.clear();
+        return;
+    }
+
+    auto delivered = std::move(m_batchDelivered);
+    m_batchDelivered.clear();
+
+    auto actions = m_engine->newArray(uint(delivered.size()));
+
+    for (int i = 0 ; i < delivered.size(); i++)
+    {
+        auto action = m_engine->newObject();
+        action.setProperty("type", delivered[i].type());
+        action.setProperty("message", scriptValue(delivered[i]));
+        actions.setProperty(quint32(i), action);
+    }
+
+    emit batchDispatched(actions);
+}
+
+void QFDispatcher::scheduleFlush()
+{
+    if (m_flushPending)
+        return;
+
+    m_flushPending = true;
+
+    // A hidden window does not render frames
+    if (!m_window.isNull() && m_window->isExposed())
+        m_window->update();
+    else
+        QTimer::singleShot(0, this, &QFDispatcher::flush);
+}
 
 void QFDispatcher::send(const QString &type, const QJSValue &message)
 {
-    m_dispatchingMessage = message;
+    // Reuse the envelope if the hook passes the action through, so a native message is not converted back.
+    if (m_hookEnvelope.isMaterialized() && m_hookEnvelope.type() == type &&
+        m_hookEnvelope.message(m_engine.data()).strictlyEquals(message))
+    {
+        auto envelope = m_hookEnvelope;
+        m_hookEnvelope = QFActionEnvelope();
+        deliverFromHook(envelope);
+        return;
+    }
+
+    QFActionEnvelope envelope(type, message);
+    deliverFromHook(envelope);
+}
+
+void QFDispatcher::sendEnvelope(const QFActionEnvelope &envelope)
+{
+    m_hookEnvelope = QFActionEnvelope();
+
+    auto current = envelope;
+    deliverFromHook(current);
+}
+
+void QFDispatcher::deliverFromHook(QFActionEnvelope &envelope)
+{
+    if (m_hookDispatching)
+    {
+        // Passed through synchronously. A nested event loop in a listener must not deliver inline.
+        QScopedValueRollback<bool> hookDispatching(m_hookDispatching, false);
+        deliver(envelope);
+        return;
+    }
+
+    if (m_dispatching)
+    {
+        // Resolved by an asynchronous middleware while another action is delivered, e.g. in a
+        // nested event loop of a modal dialog. It waits in the queue without passing the hook again.
+        envelope.setHooked(true);
+        enqueue(envelope);
+        return;
+    }
+
+    // Resolved later by an asynchronous middleware. Actions dispatched by the listeners are queued as usual.
+    DispatchingGuard dispatchingGuard(m_dispatching);
+
+    deliver(envelope);
+
+    if (m_batched)
+        scheduleFlush();
+    else
+        drainQueue();
+}
+
+void QFDispatcher::deliver(QFActionEnvelope &envelope)
+{
+    const auto type = envelope.type();
+    const auto typeId = envelope.typeId();
+
+    QFProfilerScope profilerScope(QFProfiler::Dispatcher, this, typeId);
+
+    const auto slotCount = m_slots.size();
+    m_pendingListeners.fill(false, 0, slotCount);
+    m_waitingListeners.fill(false, 0, slotCount);
+    m_visitedListeners.fill(false, 0, slotCount);
+
+    // Types without typed listeners share the key 0, unless a pattern may match them
+    const auto key = m_typedListeners.contains(typeId) || !m_patternListeners.isEmpty() ? typeId : 0;
+    auto iter = m_schedules.constFind(key);
+    if (iter == m_schedules.cend())
+        iter = m_schedules.insert(key, compileSchedule(typeId));
+
+    // A listener may change the schedules. Hold a copy of this one.
+    const auto schedule = iter.value();
+
     m_dispatchingMessageType = type;
-    m_pendingListeners.clear();
-    m_waitingListeners.clear();
+    m_dispatchingMessageTypeId = typeId;
+
+    for (const auto &id : schedule)
+        m_pendingListeners.setBit(slotOf(id));
 
-    QMapIterator<int, QPointer<QFListener>> iter(m_listeners);
-    QVector<int> ids;
-    while (iter.hasNext())
+    // The schedule already puts every listener after those it waits for.
+    for (const auto &id : schedule)
     {
-        iter.next();
-        m_pendingListeners[iter.key()] = true;
-        ids << iter.key();
+        const auto slot = slotOf(id);
+
+        // Removed, or already invoked by AppDispatcher.waitFor()
+        if (slot < 0 || !m_pendingListeners.testBit(slot))
+            continue;
+
+        m_pendingListeners.clearBit(slot);
+        m_visitedListeners.setBit(slot);
+        m_dispatchingListenerId = id;
+
+        // A native message is converted by the first listener actually invoked.
+        m_dispatchingMessage = scriptValue(envelope);
+
+        if (auto listener = m_slots[slot].listener.data(); listener)
+            listener->dispatch(type, typeId, m_dispatchingMessage);
     }
 
-    invokeListeners(ids);
+    notifySubscribers(envelope);
 
-    emit dispatched(type,message);
+    if (m_batching)
+        m_batchDelivered.append(envelope);
+
+    static const auto dispatchedSignal = QMetaMethod::fromSignal(&QFDispatcher::dispatched);
+    if (isSignalConnected(dispatchedSignal))
+        emit dispatched(type, scriptValue(envelope));
+}
+
+QJSValue QFDispatcher::scriptValue(QFActionEnvelope &envelope)
+{
+    if (!envelope.isMaterialized() && m_engine.isNull())
+        qWarning() << "QFAppDispatcher::dispatch() - Unexpected error: engine is not available.";
+
+    return envelope.message(m_engine.data());
+}
+
+void QFDispatcher::notifySubscribers(QFActionEnvelope &envelope)
+{
+    auto iter = m_subscribers.constFind(envelope.typeId());
+    if (iter == m_subscribers.cend())
+        return;
+
+    // A callback may subscribe or unsubscribe. Hold a copy of the list.
+    const auto subscribers = iter.value();
+    const auto message = envelope.variant();
+
+    for (const auto &subscriber : subscribers)
+        if (m_subscriptionTypes.contains(subscriber.id))
+            subscriber.callback(message);
 }
 
 void QFDispatcher::invokeListeners(const QVector<int> &ids)
 {
+    // Used by waitFor() only, it resolves the order of delivery on the fly.
     for (const auto &next : ids)
     {
-        if (m_waitingListeners.contains(next))
+        const auto slot = slotOf(next);
+        if (slot < 0)
+            continue;
+
+        if (m_waitingListeners.testBit(slot))
             qWarning() << QStringLiteral("AppDispatcher: Cyclic dependency detected");
 
-        if (m_pendingListeners.contains(next))
+        if (m_pendingListeners.testBit(slot))
         {
-            m_pendingListeners.remove(next);
+            m_pendingListeners.clearBit(slot);
+            m_visitedListeners.setBit(slot);
+            invokeDependencies(slot);
             m_dispatchingListenerId = next;
 
-            if (auto listener = m_listeners.value(next).data(); listener)
-                listener->dispatch(this,m_dispatchingMessageType, m_dispatchingMessage);
+            if (auto listener = m_slots[slot].listener.data(); listener)
+                listener->dispatch(m_dispatchingMessageType, m_dispatchingMessageTypeId, m_dispatchingMessage);
+        }
+        else if (!m_visitedListeners.testBit(slot))
+        {
+            // The listener is not interested in this message, but the listeners it waits for
+            // must still be invoked before the caller.
+            m_visitedListeners.setBit(slot);
+            invokeDependencies(slot);
         }
     }
 }
 
+void QFDispatcher::invokeDependencies(int slot)
+{
+    auto listener = m_slots[slot].listener.data();
+    if (!listener || listener->waitFor().empty())
+        return;
+
+    m_waitingListeners.setBit(slot);
+    invokeListeners(listener->waitFor());
+    m_waitingListeners.clearBit(slot);
+}
+
+QVector<int> QFDispatcher::compileSchedule(int typeId)
+{
+    auto bySequence = [this](int a, int b) { return m_slots[slotOf(a)].sequence < m_slots[slotOf(b)].sequence; };
+
+    // Listeners interested in this type, in registration order.
+    const auto typed = m_typedListeners.value(typeId);
+    QVector<int> roots;
+    roots.reserve(m_catchAllListeners.size() + typed.size());
+    std::merge(m_catchAllListeners.cbegin(), m_catchAllListeners.cend(),
+               typed.cbegin(), typed.cend(),
+               std::back_inserter(roots),
+               bySequence);
+
+    QVector<int> patterned;
+    for (const auto &id : qAsConst(m_patternListeners))
+    {
+        const auto listener = m_slots[slotOf(id)].listener.data();
+
+        if (listener && !typed.contains(id) && QFActionTypePatterns::matches(listener->patternIds(), typeId))
+            patterned.append(id);
+    }
+
+    if (!patterned.isEmpty())
+    {
+        QVector<int> merged;
+        merged.reserve(roots.size() + patterned.size());
+        std::merge(roots.cbegin(), roots.cend(), patterned.cbegin(), patterned.cend(), std::back_inserter(merged), bySequence);
+        roots.swap(merged);
+    }
+
+    QBitArray interested(m_slots.size());
+    for (const auto &id : roots)
+        interested.setBit(slotOf(id));
+
+    QVector<quint8> marks(m_slots.size(), 0);
+    QVector<int> schedule;
+    schedule.reserve(roots.size());
+
+    for (const auto &id : roots)
+        walkDependencies(slotOf(id), interested, marks, schedule);
+
+    return schedule;
+}
+
+void QFDispatcher::checkCycles(int slot)
+{
+    // Only the edges of this listener changed, so a new cycle passes through it.
+    QBitArray visited(m_slots.size());
+    QVector<int> stack{slot};
+
+    while (!stack.isEmpty())
+    {
+        const auto listener = m_slots[stack.takeLast()].listener.data();
+        if (!listener)
+            continue;
+
+        const auto waitFor = listener->waitFor();
+        for (const auto &id : waitFor)
+        {
+            const auto dependency = slotOf(id);
+
+            if (dependency == slot)
+            {
+                qWarning() << QStringLiteral("AppDispatcher: Cyclic dependency detected") << idOf(slot);
+                return;
+            }
+
+            if (dependency >= 0 && !visited.testBit(dependency))
+            {
+                visited.setBit(dependency);
+                stack.append(dependency);
+            }
+        }
+    }
+}
+
+void QFDispatcher::walkDependencies(int slot, const QBitArray &interested, QVector<quint8> &marks, QVector<int> &schedule)
+{
+    enum { Unvisited, Visiting, Visited };
+
+    // A cycle is reported by checkCycles() when it is made. Its edge is skipped here.
+    if (marks[slot] != Unvisited)
+        return;
+
+    marks[slot] = Visiting;
+
+    if (auto listener = m_slots[slot].listener.data(); listener)
+    {
+        const auto waitFor = listener->waitFor();
+        for (const auto &id : waitFor)
+            if (auto dependency = slotOf(id); dependency >= 0)
+                walkDependencies(dependency, interested, marks, schedule);
+    }
+
+    marks[slot] = Visited;
+
+    // Postorder: a listener comes after everything it waits for.
+    if (interested.testBit(slot))
+        schedule.append(idOf(slot));
+}
+
+void QFDispatcher::indexListener(int slot)
+{
+    auto &entry = m_slots[slot];
+    auto listener = entry.listener.data();
+    if (!listener)
+        return;
+
+    const auto id = idOf(slot);
+    const auto sequence = entry.sequence;
+
+    auto insert = [this, id, sequence](QVector<int> &bucket) {
+        auto pos = std::lower_bound(bucket.begin(), bucket.end(), sequence, [this](int other, quint64 value) {
+            return m_slots[slotOf(other)].sequence < value;
+        });
+        bucket.insert(pos, id);
+    };
+
+    if (listener->isCatchAll())
+    {
+        entry.catchAll = true;
+        insert(m_catchAllListeners);
+        return;
+    }
+
+    if (!listener->patternIds().isEmpty())
+    {
+        entry.patterned = true;
+        insert(m_patternListeners);
+    }
+
+    const auto typeIds = listener->typeIds();
+    for (const auto &typeId : typeIds)
+    {
+        if (auto &bucket = m_typedListeners[typeId]; !bucket.contains(id))
+        {
+            insert(bucket);
+            entry.typeIds.append(typeId);
+        }
+    }
+}
+
+void QFDispatcher::unindexListener(int slot)
+{
+    auto &entry = m_slots[slot];
+    const auto id = idOf(slot);
+
+    if (entry.catchAll)
+    {
+        m_catchAllListeners.removeOne(id);
+        entry.catchAll = false;
+    }
+
+    if (entry.patterned)
+    {
+        m_patternListeners.removeOne(id);
+        entry.patterned = false;
+    }
+
+    for (const auto &typeId : qAsConst(entry.typeIds))
+    {
+        auto iter = m_typedListeners.find(typeId);
+        if (iter == m_typedListeners.end())
+            continue;
+
+        iter.value().removeOne(id);
+
+        if (iter.value().empty())
+            m_typedListeners.erase(iter);
+    }
+
+    entry.typeIds.clear();
+}
+
+void QFDispatcher::releaseListener(int slot)
+{
+    unindexListener(slot);
+
+    auto &entry = m_slots[slot];
+    entry.listener.clear();
+    entry.generation = (entry.generation + 1) & GenerationMask;
+
+    m_pendingListeners.clearBit(slot);
+    m_waitingListeners.clearBit(slot);
+    m_visitedListeners.clearBit(slot);
+
+    m_freeSlots.append(slot);
+
+    m_schedules.clear();
+}
+
+void QFDispatcher::reindexListener(int slot)
+{
+    const auto &entry = m_slots[slot];
+    const auto wasCatchAll = entry.catchAll;
+    const auto wasPatterned = entry.patterned;
+    const auto oldTypeIds = entry.typeIds;
+
+    unindexListener(slot);
+    indexListener(slot);
+
+    // Only the schedules of the types it joined or left are affected. A pattern may match any type.
+    if (wasCatchAll || entry.catchAll || wasPatterned || entry.patterned)
+    {
+        m_schedules.clear();
+        return;
+    }
+
+    for (const auto &typeId : oldTypeIds)
+        m_schedules.remove(typeId);
+
+    for (const auto &typeId : qAsConst(entry.typeIds))
+        m_schedules.remove(typeId);
+}
+
+int QFDispatcher::slotOf(int id) const
+{
+    const auto slot = (id & SlotMask) - 1;
+
+    if (slot < 0 || slot >= m_slots.size() || m_slots[slot].generation != (id >> SlotBits))
+        return -1;
+
+    return slot;
+}
+
+int QFDispatcher::idOf(int slot) const
+{
+    return (m_slots[slot].generation << SlotBits) | (slot + 1);
+}
+
 QFHook *QFDispatcher::hook() const
 {
     return m_hook;
@@ -323,7 +1293,10 @@ void QFDispatcher::setHook(QFHook *hook)
     m_hook = hook;
 
     if (!m_hook.isNull())
+    {
         connect(m_hook.data(), &QFHook::dispatched, this, &QFDispatcher::send, Qt::UniqueConnection);
+        connect(m_hook.data(), &QFHook::envelopeDispatched, this, &QFDispatcher::sendEnvelope, Qt::UniqueConnection);
+    }
 }
 
 /*! \fn QQmlEngine *QFAppDispatcher::engine() const
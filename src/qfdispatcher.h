@@ -3,18 +3,37 @@
 #include <QObject>
 #include <QVariantMap>
 #include <QJSValue>
-#include <QQueue>
 #include <QPair>
 #include <QQmlEngine>
 #include <QPointer>
+#include <QQuickWindow>
+#include <QHash>
+#include <QBitArray>
+#include <atomic>
+#include <functional>
 #include "priv/qflistener.h"
+#include "priv/qfmpscqueue.h"
+#include "priv/qfringbuffer.h"
 #include "priv/qfhook.h"
+#include "priv/qfactionenvelope.h"
+#include "qfsubscription.h"
 /// Message Dispatcher
 
 class QFDispatcher : public QObject
 {
     Q_OBJECT
+    Q_PROPERTY(bool batched READ isBatched WRITE setBatched NOTIFY batchedChanged)
+    Q_PROPERTY(QQuickWindow* window READ window WRITE setWindow NOTIFY windowChanged)
+    Q_PROPERTY(int starvationLimit READ starvationLimit WRITE setStarvationLimit NOTIFY starvationLimitChanged)
 public:
+    /// Queued actions are taken from the highest lane first
+    enum Lane {
+        InputLane,
+        NormalLane,
+        BackgroundLane
+    };
+    Q_ENUM(Lane)
+
     explicit QFDispatcher(QObject *parent = nullptr);
     ~QFDispatcher() = default;
 
@@ -22,6 +41,13 @@ signals:
     /// Listeners should listen on this signal to get the latest dispatched message from AppDispatcher
     Q_SIGNAL void dispatched(const QString &type, const QJSValue &message);
 
+    /// Emitted after a batch is delivered in batched mode. Each action is an object of type and message.
+    void batchDispatched(const QJSValue &actions);
+
+    void batchedChanged();
+    void windowChanged();
+    void starvationLimitChanged();
+
 public slots:
     /// Dispatch a message via Dispatcher
     /**
@@ -41,34 +67,182 @@ public slots:
     Q_INVOKABLE void waitFor(const QVector<int> &ids);
     Q_INVOKABLE int addListener(const QJSValue &callback);
     Q_INVOKABLE void removeListener(int id);
+    Q_INVOKABLE void setCoalescing(const QString &type, const QString &key = QString());
+    Q_INVOKABLE void removeCoalescing(const QString &type);
+    Q_INVOKABLE int squashedCount(const QString &type = QString()) const;
+    Q_INVOKABLE void flush();
+    Q_INVOKABLE void setLane(const QString &type, int lane);
+    Q_INVOKABLE int lane(const QString &type) const;
+    Q_INVOKABLE QVariantList laneMetrics() const;
+    Q_INVOKABLE void resetLaneMetrics();
 
 public:
     void dispatch(const QString& type, const QVariant& message);
+    void dispatchFromAnyThread(const QString& type, const QVariant& message = QVariant());
     int addListener(QFListener* listener);
+    QFSubscription subscribe(const QString& type, std::function<void(const QVariant&)> callback);
     QQmlEngine *engine() const;
     void setEngine(QQmlEngine *engine);
     QFHook *hook() const;
     void setHook(QFHook *hook);
 
+    bool isBatched() const;
+    void setBatched(bool batched);
+
+    QQuickWindow *window() const;
+    void setWindow(QQuickWindow *window);
+
+    /// True while a batch is being delivered
+    bool isBatching() const;
+
+    int starvationLimit() const;
+    void setStarvationLimit(int starvationLimit);
+
 private slots:
     /// Invoke listener and emit the dispatched signal
     void send(const QString &type, const QJSValue &message);
 
+    /// Invoke listener with an envelope passed through by the hook
+    void sendEnvelope(const QFActionEnvelope &envelope);
+
 private:
+    friend class QFSubscription;
+
+    struct Subscriber
+    {
+        int id = 0;
+        std::function<void(const QVariant&)> callback;
+    };
+
+    void post(const QFActionEnvelope &envelope);
+    void enqueue(QFActionEnvelope envelope);
+    void drainQueue();
+    bool isQueueEmpty() const;
+
+    // Take the next action by priority. Returns false if every lane is empty.
+    bool takeQueued(QFActionEnvelope &envelope);
+    QString coalescingKey(QFActionEnvelope &envelope, const QString &key);
+    void process(QFActionEnvelope &envelope);
+    void deliver(QFActionEnvelope &envelope);
+    void deliverFromHook(QFActionEnvelope &envelope);
+    QJSValue scriptValue(QFActionEnvelope &envelope);
+    void notifySubscribers(QFActionEnvelope &envelope);
+    void unsubscribe(int id);
+
     void invokeListeners(const QVector<int> &ids);
+    void invokeDependencies(int slot);
+
+    void drainInbox();
+
+    // Request a flush at the next frame of the window, or the next iteration of the event loop
+    void scheduleFlush();
+
+    void indexListener(int slot);
+    void unindexListener(int slot);
+    void releaseListener(int slot);
+    void reindexListener(int slot);
+
+    // Compile the delivery order of an action type according to the waitFor graph.
+    QVector<int> compileSchedule(int typeId);
+    // Warn if the waitFor of the listener in slot makes it wait for itself. Called when the graph changes.
+    void checkCycles(int slot);
+    void walkDependencies(int slot, const QBitArray &interested, QVector<quint8> &marks, QVector<int> &schedule);
+
+    // Slot of a listener id. Returns -1 if the listener has been removed.
+    int slotOf(int id) const;
+    int idOf(int slot) const;
+
+    struct ListenerSlot
+    {
+        QPointer<QFListener> listener;
+
+        // Bumped when the slot is released, so that a stale id never resolves to a new listener.
+        int generation = 0;
+
+        // Registration order. It decides the order of delivery.
+        quint64 sequence = 0;
+
+        // The action types this slot has been indexed by.
+        bool catchAll = false;
+        QVector<int> typeIds;
+
+        // True if it is indexed by wildcard patterns too
+        bool patterned = false;
+    };
 
     bool m_dispatching;
 
+    // True while the hook processes the current action. Its synchronous output is delivered inline.
+    bool m_hookDispatching;
+
     QPointer<QQmlEngine> m_engine;
 
-    // Queue for dispatching messages
-    QQueue<QPair<QString,QJSValue > > m_queue;
+    struct LaneQueue
+    {
+        // A squashed action is left as an empty envelope
+        QFRingBuffer<QFActionEnvelope> queue;
+
+        // Number of envelopes taken from the queue. A position minus it is the index in the queue.
+        qint64 dequeued = 0;
 
-    // Next id for listener.
-    int m_nextListenerId;
+        // Number of actions taken from higher lanes while this lane is waiting
+        int skipped = 0;
 
-    // Registered listener
-    QMap<int, QPointer<QFListener> > m_listeners;
+        // Metrics. Times are in nanoseconds of QFProfiler::now().
+        int maxDepth = 0;
+        qint64 delivered = 0;
+        qint64 totalWait = 0;
+        qint64 maxWait = 0;
+    };
+
+    static const int LaneCount = BackgroundLane + 1;
+
+    // Queues for dispatching messages, indexed by Lane
+    LaneQueue m_lanes[LaneCount];
+
+    // Lane by action type id. The others use NormalLane.
+    QHash<int, int> m_laneOfType;
+
+    int m_starvationLimit;
+
+    // Coalescing policies by action type id. The value is the message property compared, or empty for the type only.
+    QHash<int, QString> m_coalescing;
+
+    // Lane and position of the latest queued action by type id and key
+    QHash<QPair<int, QString>, QPair<int, qint64> > m_coalescedPositions;
+
+    // Number of squashed actions by type id
+    QHash<int, int> m_squashed;
+
+    // Batched mode. Actions wait in the lanes until flush().
+    bool m_batched;
+    bool m_batching;
+    bool m_flushPending;
+    QPointer<QQuickWindow> m_window;
+
+    // Actions delivered in the current batch, kept if batchDispatched is connected
+    QVector<QFActionEnvelope> m_batchDelivered;
+
+    // Registration sequence of the next listener
+    quint64 m_nextSequence;
+
+    // Registered listener. The id of a listener encodes its slot and generation.
+    QVector<ListenerSlot> m_slots;
+
+    // Released slots to be reused by addListener()
+    QVector<int> m_freeSlots;
+
+    // Listener ids interested in every action. Sorted by registration order.
+    QVector<int> m_catchAllListeners;
+
+    // Listener ids indexed by the ids of action types they are interested in. Sorted by registration order.
+    QHash<int, QVector<int> > m_typedListeners;
+
+    // Listener ids with wildcard patterns. Sorted by registration order. They are matched when a schedule is compiled.
+    QVector<int> m_patternListeners;
+
+    // Delivery order of listener ids, keyed by action type id. Types without typed listeners share the key 0.
+    QHash<int, QVector<int> > m_schedules;
 
     // Current dispatching listener id
     int m_dispatchingListenerId;
@@ -79,12 +253,35 @@ private:
     // Current dispatching message type
     QString m_dispatchingMessageType;
 
-    // List of listeners pending to be invoked.
-    QMap<int,bool> m_pendingListeners;
+    // Interned id of current dispatching message type
+    int m_dispatchingMessageTypeId;
+
+    // Slots pending to be invoked.
+    QBitArray m_pendingListeners;
+
+    // Slots blocked in waitFor()
+    QBitArray m_waitingListeners;
 
-    // List of listeners blocked in waitFor()
-    QMap<int,bool> m_waitingListeners;
+    // Slots already invoked, or not interested in current message but whose waitFor() has been resolved
+    QBitArray m_visitedListeners;
 
     QPointer<QFHook> m_hook;
+
+    // The last action passed to the hook. A native message is kept if the hook resolves it unchanged.
+    QFActionEnvelope m_hookEnvelope;
+
+    // Native callbacks registered by subscribe(), keyed by action type id
+    QHash<int, QVector<Subscriber> > m_subscribers;
+
+    // Action type id of every active subscription
+    QHash<int, int> m_subscriptionTypes;
+
+    int m_nextSubscriptionId;
+
+    // Actions posted by dispatchFromAnyThread(), drained by the thread owning the dispatcher
+    QFMpscQueue<QPair<QString, QVariant> > m_inbox;
+
+    // True if a drain of m_inbox is already scheduled
+    std::atomic<bool> m_inboxWakePending;
 };
 
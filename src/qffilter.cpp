@@ -2,7 +2,12 @@
 #include <QMetaObject>
 #include <QtQml>
 #include "priv/quickfluxfunctions.h"
+#include "priv/qfactiontyperegistry.h"
+#include "priv/qfactiontypepatterns.h"
+#include "priv/qfprofilerscope.h"
 #include "qffilter.h"
+#include "qfstore.h"
+#include "qfpredicate.h"
 
 /*!
    \qmltype Filter
@@ -13,7 +18,8 @@ match with its type, it will emit its own "dispatched" signal. Otherwise, it wil
 simply ignore the signal.
 
 This component provides an alternative way to filter incoming message which is
-suitable for making Store component.
+suitable for making Store component. A Store keeps a table of its Filter children by
+action type, and calls only those matched with an action.
 
 Example:
 
@@ -54,11 +60,14 @@ for above problem.
 
   It is a proxy of parent's dispatched signal. If the parent emits a signal matched with the Filter::type / Filter::types property,
   it will emit this signal
+
+  If the Filter contains Predicate items, the message must satisfy all of them too.
  */
 
 
 QFFilter::QFFilter(QObject *parent)
     : QObject{parent}
+    , m_predicatesDirty{true}
 {
 }
 
@@ -92,6 +101,7 @@ QString QFFilter::type() const
 void QFFilter::setType(const QString &type)
 {
     m_types = QStringList() << type;
+    QFActionTypePatterns::compile(m_types, m_typeIds, m_patternIds);
     emit typeChanged();
     emit typesChanged();
 }
@@ -111,6 +121,13 @@ void QFFilter::componentComplete()
         return;
     }
 
+    // A store calls the filters of an action type directly
+    if (auto store = qobject_cast<QFStore *>(object))
+    {
+        store->addFilter(this);
+        return;
+    }
+
     const auto meta = object->metaObject();
 
     if (meta->indexOfSignal("dispatched(QString,QJSValue)") >= 0)
@@ -130,22 +147,32 @@ void QFFilter::componentComplete()
 
 void QFFilter::filter(const QString &type, const QJSValue &message)
 {
-    if (m_types.indexOf(type) >= 0)
-    {
-        QF_PRECHECK_DISPATCH(m_engine.data(), type, message);
-        emit dispatched(type, message);
-    }
+    if (auto typeId = QFActionTypeRegistry::lookup(type); accepts(typeId))
+        deliver(type, typeId, message);
 }
 
 void QFFilter::filter(const QString &type, const QVariant &message)
 {
-    if (m_types.indexOf(type) >= 0)
-    {
-        auto value = message.value<QJSValue>();
-        QF_PRECHECK_DISPATCH(m_engine.data(), type, value);
+    if (auto typeId = QFActionTypeRegistry::lookup(type); accepts(typeId))
+        deliver(type, typeId, message.value<QJSValue>());
+}
 
-        emit dispatched(type, value);
-    }
+bool QFFilter::accepts(int typeId) const
+{
+    return m_typeIds.contains(typeId) || QFActionTypePatterns::matches(m_patternIds, typeId);
+}
+
+void QFFilter::deliver(const QString &type, int typeId, QJSValue message)
+{
+    QFProfilerScope profilerScope(QFProfiler::Filter, this, typeId);
+    QF_PRECHECK_DISPATCH(m_engine.data(), type, message);
+
+    // A rejected action does not run any JavaScript
+    for (const auto &predicate : predicates())
+        if (!predicate.isNull() && !predicate->evaluate(message))
+            return;
+
+    emit dispatched(type, message);
 }
 
 /*! \qmlproperty array Filter::types
@@ -163,6 +190,15 @@ void QFFilter::filter(const QString &type, const QVariant &message)
   }
 \endcode
 
+A type may be a pattern with wildcards. "*" matches any sequence of characters and "?" matches a single character.
+An action type that contains "*" or "?" literally is matched exactly only if they are escaped by a backslash, e.g. "rate\\*" in QML.
+
+\code
+  Filter {
+    types: ["photo/*", "nav/back"]
+  }
+\endcode
+
 \sa Filter::type
 
  */
@@ -175,10 +211,77 @@ QStringList QFFilter::types() const
 
 void QFFilter::setTypes(const QStringList &types)
 {
+    if (m_types == types)
+        return;
+
+    const auto previousType = type();
+
     m_types = types;
+    QFActionTypePatterns::compile(types, m_typeIds, m_patternIds);
+
+    if (type() != previousType)
+        emit typeChanged();
+
+    emit typesChanged();
 }
 
 QQmlListProperty<QObject> QFFilter::children()
 {
-    return QQmlListProperty<QObject>(this, m_children);
+    return QQmlListProperty<QObject>(this, nullptr, appendChild, childCount, childAt, clearChildren);
+}
+
+void QFFilter::childEvent(QChildEvent *event)
+{
+    // A predicate created later, e.g. by Qt.createQmlObject() with the filter as parent
+    if (event->added() || event->removed())
+        m_predicatesDirty = true;
+
+    QObject::childEvent(event);
+}
+
+const QVector<QPointer<QFPredicate>> &QFFilter::predicates()
+{
+    if (!m_predicatesDirty)
+        return m_predicates;
+
+    m_predicatesDirty = false;
+    m_predicates.clear();
+
+    auto collect = [this](QObject *object) {
+        auto predicate = qobject_cast<QFPredicate *>(object);
+        if (predicate && !m_predicates.contains(predicate))
+            m_predicates.append(predicate);
+    };
+
+    for (const auto &child : qAsConst(m_children))
+        collect(child);
+
+    for (const auto &child : QObject::children())
+        collect(child);
+
+    return m_predicates;
+}
+
+void QFFilter::appendChild(QQmlListProperty<QObject> *list, QObject *object)
+{
+    auto filter = static_cast<QFFilter *>(list->object);
+    filter->m_children.append(object);
+    filter->m_predicatesDirty = true;
+}
+
+int QFFilter::childCount(QQmlListProperty<QObject> *list)
+{
+    return static_cast<QFFilter *>(list->object)->m_children.size();
+}
+
+QObject *QFFilter::childAt(QQmlListProperty<QObject> *list, int index)
+{
+    return static_cast<QFFilter *>(list->object)->m_children.at(index);
+}
+
+void QFFilter::clearChildren(QQmlListProperty<QObject> *list)
+{
+    auto filter = static_cast<QFFilter *>(list->object);
+    filter->m_children.clear();
+    filter->m_predicatesDirty = true;
 }
@@ -8,6 +8,9 @@
 #include <QQmlListProperty>
 #include <QQmlEngine>
 #include <QPointer>
+#include <QVector>
+
+class QFPredicate;
 
 // Filter represents a filter rule in AppListener
 
@@ -43,14 +46,37 @@ signals:
 protected:
     void classBegin();
     void componentComplete();
+    void childEvent(QChildEvent *event);
 
 private slots:
     void filter(const QString &type, const QJSValue &message);
     void filter(const QString &type, const QVariant &message);
 
 private:
+    friend class QFStore;
+
+    // Emit the dispatched signal for an action already matched with the types
+    void deliver(const QString &type, int typeId, QJSValue message);
+
+    // True if the type is one of the types, or matched by a pattern in them
+    bool accepts(int typeId) const;
+
+    // The Predicate children, collected again after the children are changed
+    const QVector<QPointer<QFPredicate>> &predicates();
+
+    static void appendChild(QQmlListProperty<QObject> *list, QObject *object);
+    static int childCount(QQmlListProperty<QObject> *list);
+    static QObject *childAt(QQmlListProperty<QObject> *list, int index);
+    static void clearChildren(QQmlListProperty<QObject> *list);
+
     QStringList m_types;
+    QVector<int> m_typeIds;
+    QVector<int> m_patternIds;
     QList<QObject*> m_children;
+
+    // Predicate children. They are checked before emitting dispatched.
+    QVector<QPointer<QFPredicate>> m_predicates;
+    bool m_predicatesDirty;
     QPointer<QQmlEngine> m_engine;
 };
 
@@ -1,6 +1,7 @@
 #include <QtCore>
 #include <QMetaObject>
 #include "qfkeytable.h"
+#include "priv/qfactiontyperegistry.h"
 
 /*!
   \qmltype KeyTable
@@ -161,10 +162,15 @@ void QFKeyTable::componentComplete()
         if (p.type() != QVariant::String || name == QStringLiteral("objectName"))
             continue;
 
+        // Intern the keys in advance. They are likely to be used as action types.
         if (auto v = property(p.name()); !v.isNull())
+        {
+            QFActionTypeRegistry::intern(v.toString());
             continue;
+        }
 
         setProperty(p.name(), name);
+        QFActionTypeRegistry::intern(name);
     }
 
 }
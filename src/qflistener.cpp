@@ -1,10 +1,13 @@
 #include <QtCore>
-#include "qfdispatcher.h"
 #include "priv/qflistener.h"
+#include "priv/qfactiontyperegistry.h"
+#include "priv/qfactiontypepatterns.h"
+#include "priv/qfprofilerscope.h"
 
 QFListener::QFListener(QObject *parent)
     : QObject(parent)
     , m_listenerId{0}
+    , m_catchAll{true}
 {
 }
 
@@ -18,11 +21,10 @@ void QFListener::setCallback(const QJSValue &callback)
     m_callback = callback;
 }
 
-void QFListener::dispatch(QFDispatcher *dispatcher, const QString &type, const QJSValue &message)
+void QFListener::dispatch(const QString &type, int typeId, const QJSValue &message)
 {
-
-    if (!m_waitFor.empty())
-        dispatcher->waitFor(m_waitFor);
+    // The owner, e.g. AppListener, is reported as the receiver
+    QFProfilerScope profilerScope(QFProfiler::Listener, parent() ? parent() : this, typeId);
 
     if (m_callback.isCallable())
     {
@@ -38,7 +40,7 @@ void QFListener::dispatch(QFDispatcher *dispatcher, const QString &type, const Q
         }
     }
 
-    emit dispatched(type,message);
+    emit dispatched(type, message, typeId);
 }
 
 int QFListener::listenerId() const
@@ -56,8 +58,59 @@ QVector<int> QFListener::waitFor() const
     return m_waitFor;
 }
 
+/// Declare the listeners to be invoked before this one. The dispatcher compiles them into its delivery order.
 void QFListener::setWaitFor(const QVector<int> &waitFor)
 {
+    if (m_waitFor == waitFor)
+        return;
+
     m_waitFor = waitFor;
+    emit waitForChanged();
+}
+
+
+QStringList QFListener::types() const
+{
+    return m_types;
+}
+
+/// Declare the action types this listener is interested in. The dispatcher will skip it for any other type.
+/// A type may be a wildcard pattern, e.g. "photo/*".
+void QFListener::setTypes(const QStringList &types)
+{
+    if (!m_catchAll && m_types == types)
+        return;
+
+    m_types = types;
+    QFActionTypePatterns::compile(types, m_typeIds, m_patternIds);
+    m_catchAll = false;
+    emit typesChanged();
+}
+
+/// Make this listener receive every action regardless of its type. It is the default.
+void QFListener::clearTypes()
+{
+    if (m_catchAll)
+        return;
+
+    m_types.clear();
+    m_typeIds.clear();
+    m_patternIds.clear();
+    m_catchAll = true;
+    emit typesChanged();
+}
+
+QVector<int> QFListener::typeIds() const
+{
+    return m_typeIds;
 }
 
+QVector<int> QFListener::patternIds() const
+{
+    return m_patternIds;
+}
+
+bool QFListener::isCatchAll() const
+{
+    return m_catchAll;
+}
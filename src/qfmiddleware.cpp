@@ -1,6 +1,8 @@
 #include <QQmlEngine>
 #include "qfmiddleware.h"
 #include "priv/quickfluxfunctions.h"
+#include "priv/qffilterfunctiontable.h"
+#include "priv/qfmiddlewareshook.h"
 
 
 /*!
@@ -66,6 +68,8 @@ Middleware {
 QFMiddleware::QFMiddleware(QQuickItem* parent)
     : QQuickItem{parent}
       , m_filterFunctionEnabled{false}
+      , m_filterFunctions{nullptr}
+      , m_index{-1}
 {
 }
 
@@ -92,27 +96,81 @@ Middleware {
 
 The default value is false
  */
+
+/*! \qmlproperty array Middleware::types
+
+The action types this middleware intercepts. Other actions are passed to the next middleware directly,
+without calling the dispatch function or any filter function.
+
+\code
+
+Middleware {
+  types: [ActionTypes.removeItem]
+
+  function dispatch(type, message) {
+    // Only removeItem is received here
+    next(type, message);
+  }
+}
+\endcode
+
+If it is empty, the middleware intercepts every action. But if it has no dispatch function and filterFunctionEnabled is true,
+it only receives the types with a filter function.
+
+The default value is an empty list
+ */
 void QFMiddleware::next(const QString &type, const QJSValue &message)
 {
     auto engine = qmlEngine(this);
     QF_PRECHECK_DISPATCH(engine, type, message);
 
-    if (m_nextCallback.isCallable())
-    {
-        auto args = QJSValueList{} << type << message;
+    if (!m_hook.isNull())
+        m_hook->next(m_index, type, message);
+}
 
-        if (auto result = m_nextCallback.call(args); result.isError())
-            QuickFlux::printException(result);
-    }
+void QFMiddleware::setHook(QFMiddlewaresHook *hook, int index)
+{
+    m_hook = hook;
+    m_index = index;
+}
+
+bool QFMiddleware::invokeFilterFunction(const QString &type, int typeId, const QJSValue &message)
+{
+    if (!m_filterFunctionEnabled)
+        return false;
+
+    if (!m_filterFunctions)
+        m_filterFunctions = QFFilterFunctionTable::of(metaObject());
+
+    return m_filterFunctions->invoke(this, type, typeId, message);
 }
 
-QJSValue QFMiddleware::nextCallback() const
+bool QFMiddleware::hasFilterFunction(const QString &type, int typeId)
 {
-    return m_nextCallback;
+    if (!m_filterFunctionEnabled)
+        return false;
+
+    if (!m_filterFunctions)
+        m_filterFunctions = QFFilterFunctionTable::of(metaObject());
+
+    return m_filterFunctions->contains(metaObject(), type, typeId);
 }
 
-void QFMiddleware::setNextCallback(const QJSValue &value)
+bool QFMiddleware::filterFunctionEnabled() const
 {
-    m_nextCallback = value;
-    emit _nextCallbackChanged();
+    return m_filterFunctionEnabled;
+}
+
+QStringList QFMiddleware::types() const
+{
+    return m_types;
+}
+
+void QFMiddleware::setTypes(const QStringList &types)
+{
+    if (m_types == types)
+        return;
+
+    m_types = types;
+    emit typesChanged();
 }
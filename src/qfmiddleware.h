@@ -3,31 +3,48 @@
 
 #include <QQuickItem>
 #include <QJSValue>
+#include <QPointer>
+
+class QFFilterFunctionTable;
+class QFMiddlewaresHook;
 
 class QFMiddleware : public QQuickItem
 {
     Q_OBJECT
     Q_PROPERTY(bool filterFunctionEnabled MEMBER m_filterFunctionEnabled NOTIFY filterFunctionEnabledChanged)
-    Q_PROPERTY(QJSValue _nextCallback READ nextCallback WRITE setNextCallback NOTIFY _nextCallbackChanged)
+    Q_PROPERTY(QStringList types READ types WRITE setTypes NOTIFY typesChanged)
 
 public:
     QFMiddleware(QQuickItem* parent = nullptr);
 
-    QJSValue nextCallback() const;
-    void setNextCallback(const QJSValue &nextCallback);
+    void setHook(QFMiddlewaresHook *hook, int index);
+
+    bool invokeFilterFunction(const QString &type, int typeId, const QJSValue &message);
+
+    /// True if filterFunctionEnabled is set and there is a filter function of the type
+    bool hasFilterFunction(const QString &type, int typeId);
+
+    bool filterFunctionEnabled() const;
+
+    QStringList types() const;
+    void setTypes(const QStringList &types);
 
 signals:
     void dispatched(const QString &type, const QJSValue &message);
     void filterFunctionEnabledChanged();
-    void _nextCallbackChanged();
+    void typesChanged();
 
 public slots:
     void next(const QString &type, const QJSValue &message = QJSValue());
 
 private:
     bool m_filterFunctionEnabled;
+    QFFilterFunctionTable *m_filterFunctions;
+    QStringList m_types;
 
-    QJSValue m_nextCallback;
+    // The chain this middleware is installed in, and its position
+    QPointer<QFMiddlewaresHook> m_hook;
+    int m_index;
 
 };
 
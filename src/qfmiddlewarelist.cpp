@@ -42,6 +42,9 @@ Item {
 
 \endcode
 
+Middlewares are called in the order of declaration. Beside Middleware, it accepts objects
+inherited from QFNativeMiddleware, which are implemented in C++ and could process an action without the QML engine.
+
 It is added since QuickFlux 1.1
 
     */
@@ -53,9 +56,48 @@ It is added since QuickFlux 1.1
  *
  */
 
+/*! \qmlproperty enumeration MiddlewareList::ordering
+
+A middleware may return a Promise from its dispatch function, and call next() when the work is done.
+The action stays in flight until the promise is settled. Meanwhile the dispatcher continues with the other actions,
+and this property decides the order of the actions leaving the middlewares.
+
+\list
+\li MiddlewareList.StrictFifo - Actions reach the stores in the order they were dispatched.
+An action waits for all the earlier actions in flight.
+\li MiddlewareList.PerTypeFifo - Only the actions of the same type keep their order.
+\endlist
+
+\code
+Middleware {
+  function dispatch(type, message, next) {
+    if (type !== ActionTypes.loadImage) {
+        next(type, message);
+        return;
+    }
+
+    return imageLoader.load(message.url).then(function(image) {
+        next(type, {url: message.url, image: image});
+    });
+  }
+}
+\endcode
+
+The third parameter of dispatch is optional. It is a next() function bound to the action when dispatch is called, which is needed
+when a middleware has several promises pending. Otherwise, a next() called after dispatch returns is counted for the only pending
+promise of the middleware. If several promises are pending, or none, e.g. next() is called from a dialog, the action is passed
+to the stores immediately, regardless of the ordering.
+
+A promise that is never settled keeps its action in flight forever. With MiddlewareList.StrictFifo, every later action waits
+for it too. A middleware that depends on an unreliable source should reject the promise on error or after a timeout.
+
+The default value is MiddlewareList.StrictFifo
+ */
+
 QFMiddlewareList::QFMiddlewareList(QQuickItem* parent)
     : QQuickItem{parent}
     , m_engine{}
+    , m_ordering{StrictFifo}
 {
 }
 
@@ -66,10 +108,8 @@ void QFMiddlewareList::apply(QObject *source)
 
 void QFMiddlewareList::next(int senderIndex, const QString &type, const QJSValue &message)
 {
-    auto args = QJSValueList{} << QJSValue{senderIndex + 1} << QJSValue{type} << message;
-
-    if (auto result = invoke.call(args); result.isError())
-        QuickFlux::printException(result);
+    if (!m_hook.isNull())
+        m_hook->next(senderIndex, type, message);
 }
 
 void QFMiddlewareList::classBegin()
@@ -84,6 +124,15 @@ void QFMiddlewareList::componentComplete()
         setup();
 }
 
+void QFMiddlewareList::childEvent(QChildEvent *event)
+{
+    QQuickItem::childEvent(event);
+
+    // The child is not yet a member of the data property while it is being added
+    if (!m_hook.isNull())
+        m_hook->invalidate();
+}
+
 void QFMiddlewareList::setup()
 {
     auto creator = qobject_cast<QFActionCreator*>(m_applyTarget.data());
@@ -121,6 +170,8 @@ void QFMiddlewareList::setup()
         auto hook = new QFMiddlewaresHook();
         hook->setParent(this);
         hook->setup(m_engine.data(), this);
+        hook->setOrdering(m_ordering);
+        m_hook = hook;
 
         if (!m_dispatcher.isNull())
             m_dispatcher->setHook(hook);
@@ -141,3 +192,21 @@ void QFMiddlewareList::setApplyTarget(QObject *applyTarget)
 
     emit applyTargetChanged();
 }
+
+QFMiddlewareList::Ordering QFMiddlewareList::ordering() const
+{
+    return m_ordering;
+}
+
+void QFMiddlewareList::setOrdering(Ordering ordering)
+{
+    if (m_ordering == ordering)
+        return;
+
+    m_ordering = ordering;
+
+    if (!m_hook.isNull())
+        m_hook->setOrdering(ordering);
+
+    emit orderingChanged();
+}
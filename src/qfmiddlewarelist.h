@@ -3,18 +3,31 @@
 #include <QPointer>
 #include <qfactioncreator.h>
 
+class QFMiddlewaresHook;
+
 class QFMiddlewareList : public QQuickItem
 {
     Q_OBJECT
     Q_PROPERTY(QObject* applyTarget READ applyTarget WRITE setApplyTarget NOTIFY applyTargetChanged)
+    Q_PROPERTY(Ordering ordering READ ordering WRITE setOrdering NOTIFY orderingChanged)
 public:
+    enum Ordering {
+        StrictFifo,
+        PerTypeFifo
+    };
+    Q_ENUM(Ordering)
+
     QFMiddlewareList(QQuickItem* parent = nullptr);
 
     QObject *applyTarget() const;
     void setApplyTarget(QObject *applyTarget);
 
+    Ordering ordering() const;
+    void setOrdering(Ordering ordering);
+
 signals:
     void applyTargetChanged();
+    void orderingChanged();
 
 public slots:
 
@@ -25,6 +38,7 @@ public slots:
 protected:
     void classBegin();
     void componentComplete();
+    void childEvent(QChildEvent *event);
 
 private slots:
     void setup();
@@ -35,8 +49,10 @@ private:
 
     QPointer<QFActionCreator> m_actionCreator;
     QPointer<QFDispatcher> m_dispatcher;
-    QJSValue invoke;
+    QPointer<QFMiddlewaresHook> m_hook;
 
     QPointer<QObject> m_applyTarget;
 
+    Ordering m_ordering;
+
 };
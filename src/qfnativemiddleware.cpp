@@ -0,0 +1,207 @@
+#include <QThread>
+#include <QAbstractEventDispatcher>
+#include <QThreadPool>
+#include <QRunnable>
+#include "qfnativemiddleware.h"
+#include "priv/qfmiddlewareshook.h"
+
+namespace {
+
+class Task : public QRunnable
+{
+public:
+    Task(const QFNativeMiddleware::Next &next, std::function<void(const QFNativeMiddleware::Next &)> task)
+        : m_next(next)
+        , m_task(std::move(task))
+    {
+    }
+
+    void run() override
+    {
+        m_task(m_next);
+    }
+
+private:
+    QFNativeMiddleware::Next m_next;
+    std::function<void(const QFNativeMiddleware::Next &)> m_task;
+};
+
+}
+
+// The hook is only read on its thread. Other threads post to the event dispatcher of that thread,
+// which outlives the hook.
+struct QFNativeMiddleware::Next::State
+{
+    QPointer<QFMiddlewaresHook> hook;
+    QThread *thread;
+
+    // The middleware and its position in the chain of the generation
+    QObject *sender;
+    int index;
+    int generation;
+    qint64 serial;
+
+    ~State()
+    {
+        if (QThread::currentThread() == thread)
+        {
+            if (!hook.isNull())
+                hook->release(serial);
+            return;
+        }
+
+        post([target = std::move(hook), id = serial]() {
+            if (!target.isNull())
+                target->release(id);
+        });
+    }
+
+    // Run the function on the thread of the hook
+    void post(std::function<void()> function) const
+    {
+        if (auto dispatcher = QAbstractEventDispatcher::instance(thread))
+            QMetaObject::invokeMethod(dispatcher, std::move(function), Qt::QueuedConnection);
+    }
+
+    void next(const QFActionEnvelope &envelope)
+    {
+        if (!hook.isNull())
+            hook->proceed(sender, index, generation, serial, envelope);
+    }
+};
+
+/*! \class QFNativeMiddleware
+    \inmodule QuickFlux
+
+    QFNativeMiddleware is the base class of a middleware written in C++. It works like the
+    Middleware component, but it is not an item and its process() function is called
+    without the QML engine.
+
+    \code
+
+    class AuthMiddleware : public QFNativeMiddleware {
+    public:
+        void process(const QString &type, QFActionEnvelope &envelope, const Next &next) override {
+            if (type == "removeAccount" && !isAdmin())
+                return; // Dropped
+
+            next(envelope);
+        }
+    };
+
+    \endcode
+
+    The message is available by envelope.variant(). Calling it converts a message
+    dispatched from QML once. It is added since QuickFlux 1.1
+ */
+
+/*! \fn void QFNativeMiddleware::process(const QString &type, QFActionEnvelope &envelope, const Next &next)
+
+  This function is called when an action reaches this middleware. Call \a next with the \a envelope,
+  or with a new type and message, to pass it to the next middleware. If it is not called, the action is dropped.
+
+  A copy of \a next could be called later, e.g. when an I/O operation is finished on another thread.
+  The action is regarded as finished when all the copies are destroyed. Pass a QVariant message
+  from a worker thread, as QJSValue may only be used in the thread of the engine.
+ */
+
+/*! \fn QFNativeMiddleware::Next QFNativeMiddleware::Next::detached() const
+
+  Returns a copy of this continuation that does not keep the action in flight. Use it for an action passed
+  on long after process() returns, e.g. by a timer, so the later actions are not blocked meanwhile.
+ */
+
+/*! \fn void QFNativeMiddleware::runAsync(const Next &next, std::function<void(const Next &next)> task, QThreadPool *pool)
+
+  Run \a task with \a next on \a pool, or QThreadPool::globalInstance() if it is null. The dispatcher keeps
+  delivering the other actions meanwhile.
+
+  \code
+
+    void process(const QString &type, QFActionEnvelope &envelope, const Next &next) override {
+        const auto path = envelope.variant().toMap().value("path").toString();
+
+        runAsync(next, [type, path](const Next &next) {
+            next(type, QVariantMap{{"path", path}, {"content", readFile(path)}});
+        });
+    }
+
+  \endcode
+ */
+
+/*! \property QFNativeMiddleware::types
+
+  The action types passed to process(). Other actions skip this middleware.
+  If it is empty, every action is processed. The default value is an empty list.
+ */
+
+QFNativeMiddleware::QFNativeMiddleware(QObject *parent) : QObject(parent)
+{
+}
+
+QStringList QFNativeMiddleware::types() const
+{
+    return m_types;
+}
+
+void QFNativeMiddleware::setTypes(const QStringList &types)
+{
+    if (m_types == types)
+        return;
+
+    m_types = types;
+    emit typesChanged();
+}
+
+QFNativeMiddleware::Next::Next()
+{
+}
+
+QFNativeMiddleware::Next::Next(QFMiddlewaresHook *hook, int index, qint64 serial)
+    : m_state{new State{hook, hook->thread(), hook->middlewareAt(index), index, hook->generation(), serial}}
+{
+    hook->hold(serial);
+}
+
+void QFNativeMiddleware::Next::operator()(const QFActionEnvelope &envelope) const
+{
+    auto state = m_state;
+
+    if (!state)
+        return;
+
+    if (QThread::currentThread() == state->thread)
+    {
+        state->next(envelope);
+        return;
+    }
+
+    // The captured state holds the action until the call is delivered
+    state->post([state, envelope]() {
+        state->next(envelope);
+    });
+}
+
+void QFNativeMiddleware::Next::operator()(const QString &type, const QVariant &message) const
+{
+    operator()(QFActionEnvelope(type, message));
+}
+
+QFNativeMiddleware::Next QFNativeMiddleware::Next::detached() const
+{
+    if (!m_state)
+        return Next();
+
+    // It does not hold an action, so it does not call the hook now
+    Next next;
+    next.m_state.reset(new State{m_state->hook, m_state->thread, m_state->sender, m_state->index, m_state->generation, 0});
+    return next;
+}
+
+void QFNativeMiddleware::runAsync(const Next &next, std::function<void(const Next &)> task, QThreadPool *pool)
+{
+    if (!pool)
+        pool = QThreadPool::globalInstance();
+
+    pool->start(new Task(next, std::move(task)));
+}
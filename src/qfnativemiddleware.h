@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+#include <functional>
+#include <memory>
+#include "priv/qfactionenvelope.h"
+
+class QFMiddlewaresHook;
+class QThreadPool;
+
+/// A middleware implemented in C++
+/**
+  Subclass it and override process(). The object could be inserted into a MiddlewareList along with
+  the Middleware items, e.g. declare it in QML after registering it by qmlRegisterType(), or append it
+  to the data property of the list. The chain runs in the declaration order.
+
+  An action dispatched from C++ passes through it without being converted to QJSValue.
+
+  A middleware could keep a copy of next and call it later, from any thread. The action stays in flight
+  until every copy is destroyed, and the outputs are ordered by MiddlewareList.ordering.
+ */
+
+class QFNativeMiddleware : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QStringList types READ types WRITE setTypes NOTIFY typesChanged)
+public:
+    /// Passes an action to the next middleware. It may be copied and called later, from any thread.
+    class Next
+    {
+    public:
+        Next();
+
+        void operator()(const QFActionEnvelope &envelope) const;
+        void operator()(const QString &type, const QVariant &message = QVariant()) const;
+
+        /// A copy that does not hold the action in flight. An action passed to it later is not ordered.
+        Next detached() const;
+
+    private:
+        friend class QFMiddlewaresHook;
+
+        struct State;
+
+        Next(QFMiddlewaresHook *hook, int index, qint64 serial);
+
+        std::shared_ptr<State> m_state;
+    };
+
+    explicit QFNativeMiddleware(QObject *parent = nullptr);
+
+    /// Process an action. Call next to pass it on, or return without calling it to drop it.
+    virtual void process(const QString &type, QFActionEnvelope &envelope, const Next &next) = 0;
+
+    /// The action types to be processed. Empty for all types.
+    QStringList types() const;
+    void setTypes(const QStringList &types);
+
+signals:
+    void typesChanged();
+
+protected:
+    /// Run the task on a thread pool, the global one by default. The action waits for it in flight.
+    static void runAsync(const Next &next, std::function<void(const Next &next)> task, QThreadPool *pool = nullptr);
+
+private:
+    QStringList m_types;
+};
@@ -0,0 +1,246 @@
+#include <QtQml>
+#include "qfpredicate.h"
+
+/*!
+   \qmltype Predicate
+   \inqmlmodule QuickFlux 1.1
+   \brief A condition on the message of a Filter
+
+Predicate is declared inside a Filter. The Filter checks the message against its predicates
+before emitting the dispatched signal, so an action rejected by a predicate does not run any JavaScript.
+A Filter with several predicates requires all of them.
+
+\code
+
+Store {
+    id: store
+    property int currentId: 0
+
+    Filter {
+        type: ActionTypes.updateItem
+
+        Predicate {
+            path: "item.id"
+            equals: store.currentId
+        }
+
+        onDispatched: {
+            // Only for the current item
+        }
+    }
+}
+
+\endcode
+
+The values are compared like the === operator. A number is not equal to a string of it.
+
+*/
+
+namespace {
+
+bool isNumber(const QVariant &value)
+{
+    switch (value.userType())
+    {
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Double:
+    case QMetaType::Float:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// A value of a var property may be held as QJSValue
+QVariant normalize(const QVariant &value)
+{
+    if (value.userType() == qMetaTypeId<QJSValue>())
+        return value.value<QJSValue>().toVariant();
+
+    return value;
+}
+
+bool isEqual(const QJSValue &value, const QVariant &constant)
+{
+    if (value.isNumber())
+        return isNumber(constant) && value.toNumber() == constant.toDouble();
+
+    if (value.isString())
+        return constant.userType() == QMetaType::QString && value.toString() == constant.toString();
+
+    if (value.isBool())
+        return constant.userType() == QMetaType::Bool && value.toBool() == constant.toBool();
+
+    if (value.isUndefined())
+        return false;
+
+    if (value.isNull())
+        return constant.isNull();
+
+    return value.toVariant() == constant;
+}
+
+// Returns -1, 0 or 1, or -2 if they are not comparable
+int compare(const QJSValue &value, const QVariant &constant)
+{
+    if (value.isNumber() && isNumber(constant))
+    {
+        const auto number = value.toNumber();
+        const auto other = constant.toDouble();
+        return number < other ? -1 : (number > other ? 1 : 0);
+    }
+
+    if (value.isString() && constant.userType() == QMetaType::QString)
+        return qBound(-1, value.toString().compare(constant.toString()), 1);
+
+    return -2;
+}
+
+}
+
+QFPredicate::QFPredicate(QObject *parent)
+    : QObject(parent)
+    , m_hasOneOf(false)
+{
+}
+
+bool QFPredicate::evaluate(const QJSValue &message) const
+{
+    auto value = message;
+
+    for (const auto &segment : m_segments)
+    {
+        if (!value.isObject())
+            return false;
+
+        value = value.property(segment);
+    }
+
+    if (m_equals.isValid() && !isEqual(value, m_equals))
+        return false;
+
+    if (m_hasOneOf)
+    {
+        auto found = false;
+
+        for (const auto &constant : m_oneOf)
+        {
+            if (isEqual(value, constant))
+            {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+            return false;
+    }
+
+    if (m_min.isValid())
+    {
+        const auto result = compare(value, m_min);
+        if (result == -2 || result < 0)
+            return false;
+    }
+
+    if (m_max.isValid())
+    {
+        const auto result = compare(value, m_max);
+        if (result == -2 || result > 0)
+            return false;
+    }
+
+    return true;
+}
+
+/*! \qmlproperty string Predicate::path
+
+  The property of the message to be checked, e.g. "id" or "item.id". If it is empty, the message itself is checked.
+ */
+
+QString QFPredicate::path() const
+{
+    return m_path;
+}
+
+void QFPredicate::setPath(const QString &path)
+{
+    if (m_path == path)
+        return;
+
+    m_path = path;
+    m_segments = path.isEmpty() ? QStringList() : path.split(QLatin1Char('.'));
+    emit pathChanged();
+}
+
+/*! \qmlproperty var Predicate::equals
+
+  The value must be equal to it. It could be bound to a property, e.g. the id of the current item.
+  If it is undefined, it is not checked.
+ */
+
+QVariant QFPredicate::equals() const
+{
+    return m_equals;
+}
+
+void QFPredicate::setEquals(const QVariant &equals)
+{
+    m_equals = normalize(equals);
+    emit equalsChanged();
+}
+
+/*! \qmlproperty array Predicate::oneOf
+
+  The value must be equal to one of them. If it is not set, it is not checked.
+ */
+
+QVariantList QFPredicate::oneOf() const
+{
+    return m_oneOf;
+}
+
+void QFPredicate::setOneOf(const QVariantList &oneOf)
+{
+    m_oneOf.clear();
+    for (const auto &constant : oneOf)
+        m_oneOf << normalize(constant);
+
+    m_hasOneOf = true;
+    emit oneOfChanged();
+}
+
+/*! \qmlproperty var Predicate::min
+
+  The value must be a number or a string not less than it. If it is undefined, it is not checked.
+ */
+
+QVariant QFPredicate::minimum() const
+{
+    return m_min;
+}
+
+void QFPredicate::setMinimum(const QVariant &minimum)
+{
+    m_min = normalize(minimum);
+    emit minChanged();
+}
+
+/*! \qmlproperty var Predicate::max
+
+  The value must be a number or a string not greater than it. If it is undefined, it is not checked.
+ */
+
+QVariant QFPredicate::maximum() const
+{
+    return m_max;
+}
+
+void QFPredicate::setMaximum(const QVariant &maximum)
+{
+    m_max = normalize(maximum);
+    emit maxChanged();
+}
@@ -0,0 +1,62 @@
+#ifndef QFPREDICATE_H
+#define QFPREDICATE_H
+
+#include <QObject>
+#include <QJSValue>
+#include <QVariant>
+#include <QStringList>
+
+// Predicate is a condition on the message, checked by its parent Filter before emitting dispatched
+
+class QFPredicate : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString path READ path WRITE setPath NOTIFY pathChanged)
+    Q_PROPERTY(QVariant equals READ equals WRITE setEquals NOTIFY equalsChanged)
+    Q_PROPERTY(QVariantList oneOf READ oneOf WRITE setOneOf NOTIFY oneOfChanged)
+    Q_PROPERTY(QVariant min READ minimum WRITE setMinimum NOTIFY minChanged)
+    Q_PROPERTY(QVariant max READ maximum WRITE setMaximum NOTIFY maxChanged)
+
+public:
+    explicit QFPredicate(QObject *parent = nullptr);
+
+    /// True if the message satisfies every condition set
+    bool evaluate(const QJSValue &message) const;
+
+    QString path() const;
+    void setPath(const QString &path);
+
+    QVariant equals() const;
+    void setEquals(const QVariant &equals);
+
+    QVariantList oneOf() const;
+    void setOneOf(const QVariantList &oneOf);
+
+    QVariant minimum() const;
+    void setMinimum(const QVariant &minimum);
+
+    QVariant maximum() const;
+    void setMaximum(const QVariant &maximum);
+
+signals:
+    void pathChanged();
+    void equalsChanged();
+    void oneOfChanged();
+    void minChanged();
+    void maxChanged();
+
+private:
+    QString m_path;
+
+    // The path split by dots. It is empty for the message itself.
+    QStringList m_segments;
+
+    // An invalid value is not checked
+    QVariant m_equals;
+    QVariantList m_oneOf;
+    bool m_hasOneOf;
+    QVariant m_min;
+    QVariant m_max;
+};
+
+#endif // QFPREDICATE_H
@@ -0,0 +1,386 @@
+#include <QtCore>
+#include <QtQml>
+#include <chrono>
+#include <algorithm>
+#include "qfprofiler.h"
+#include "priv/qfactiontyperegistry.h"
+#include "priv/qftracebuffer.h"
+
+/*!
+   \qmltype Profiler
+   \inqmlmodule QuickFlux 1.1
+   \brief Measure the time spent on action delivery
+
+   Profiler is a singleton object to find out which listener or store makes an action slow.
+   It is disabled by default. Once enabled, it records the calls of every AppListener, AppScript,
+   Store, Filter and Middleware per action type.
+
+\code
+import QuickFlux 1.1
+
+Item {
+  Component.onCompleted: Profiler.enabled = true
+
+  function dumpProfile() {
+    Profiler.report().forEach(function(entry) {
+      console.log(entry.category, entry.receiver, entry.type, entry.count, entry.totalTime);
+    });
+  }
+}
+\endcode
+
+  The time of a Middleware includes the middlewares after it, as they are called by its next() function.
+  The time of a Store does not include its children.
+
+  Set \l{Profiler::tracing} to keep a timeline of every call, and call saveTrace() to write it as a
+  Chrome Trace Event file. It could be opened by chrome://tracing or https://ui.perfetto.dev.
+
+ */
+
+namespace {
+
+struct RecordKey
+{
+    int category;
+    const QObject *receiver;
+    int typeId;
+
+    bool operator==(const RecordKey &other) const
+    {
+        return category == other.category && receiver == other.receiver && typeId == other.typeId;
+    }
+};
+
+uint qHash(const RecordKey &key, uint seed = 0)
+{
+    return ::qHash(key.receiver, seed) ^ ::qHash(key.typeId, seed) ^ uint(key.category);
+}
+
+struct Record
+{
+    QString receiver;
+
+    std::atomic<quint64> count{0};
+    std::atomic<quint64> totalTime{0};
+    std::atomic<quint64> maxTime{0};
+    std::atomic<quint64> histogram[QFProfiler::BucketCount] = {};
+};
+
+struct Records
+{
+    QReadWriteLock lock;
+    QHash<RecordKey, Record*> records;
+};
+
+Records &records()
+{
+    static Records instance;
+    return instance;
+}
+
+QString receiverName(const QObject *receiver)
+{
+    if (!receiver)
+        return QString();
+
+    if (!receiver->objectName().isEmpty())
+        return receiver->objectName();
+
+    if (auto context = qmlContext(receiver); context)
+    {
+        if (auto name = context->nameForObject(const_cast<QObject*>(receiver)); !name.isEmpty())
+            return name;
+    }
+
+    return QStringLiteral("%1(0x%2)").arg(QString::fromLatin1(receiver->metaObject()->className()))
+                                     .arg(quintptr(receiver), 0, 16);
+}
+
+// Receiver names resolved by this thread. Dropped when the generation changes.
+QString cachedReceiverName(const QObject *receiver)
+{
+    static std::atomic<int> generation{0};
+    thread_local int cachedGeneration = -1;
+    thread_local QHash<const QObject*, QString> names;
+
+    if (!receiver)
+    {
+        // Invalidate all the caches
+        generation.fetch_add(1, std::memory_order_relaxed);
+        return QString();
+    }
+
+    if (auto current = generation.load(std::memory_order_relaxed); current != cachedGeneration)
+    {
+        names.clear();
+        cachedGeneration = current;
+    }
+
+    auto iter = names.constFind(receiver);
+    if (iter == names.cend())
+        iter = names.insert(receiver, receiverName(receiver));
+
+    return iter.value();
+}
+
+int bucketOf(qint64 elapsed)
+{
+    int bucket = 0;
+    while (elapsed > 1 && bucket < QFProfiler::BucketCount - 1)
+    {
+        elapsed >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+}
+
+std::atomic<int> QFProfiler::s_flags{0};
+
+QFProfiler::QFProfiler(QObject *parent)
+    : QObject{parent}
+{
+}
+
+/// Obtain the profiler of this process
+QFProfiler *QFProfiler::instance()
+{
+    static QFProfiler profiler;
+    return &profiler;
+}
+
+qint64 QFProfiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*! \qmlproperty bool Profiler::enabled
+
+  Set it to true to start recording. The default value is false.
+
+ */
+
+bool QFProfiler::isEnabledProperty() const
+{
+    return isEnabled();
+}
+
+void QFProfiler::setEnabled(bool enabled)
+{
+    if (isEnabled() == enabled)
+        return;
+
+    setFlag(EnabledFlag, enabled);
+    emit enabledChanged();
+}
+
+/*! \qmlproperty bool Profiler::tracing
+
+  Set it to true to keep every call as a span of a timeline. The default value is false.
+
+  The latest 65536 events are kept per thread.
+
+ */
+
+bool QFProfiler::isTracingProperty() const
+{
+    return isTracing();
+}
+
+void QFProfiler::setTracing(bool tracing)
+{
+    if (isTracing() == tracing)
+        return;
+
+    setFlag(TracingFlag, tracing);
+    emit tracingChanged();
+}
+
+void QFProfiler::setFlag(Flag flag, bool on)
+{
+    if (on)
+        s_flags.fetch_or(flag, std::memory_order_relaxed);
+    else
+        s_flags.fetch_and(~flag, std::memory_order_relaxed);
+}
+
+void QFProfiler::span(Category category, const QObject *receiver, int typeId, qint64 start, qint64 end)
+{
+    if (isEnabled())
+        record(category, receiver, typeId, end - start);
+
+    if (isTracing())
+    {
+        QFTraceBuffer::Event event;
+        event.category = category;
+        event.typeId = typeId;
+        event.start = start;
+        event.duration = end - start;
+        event.receiver = cachedReceiverName(receiver);
+        QFTraceBuffer::local()->append(event);
+    }
+}
+
+void QFProfiler::mark(Category category, const QObject *receiver, int typeId)
+{
+    if (!isTracing())
+        return;
+
+    QFTraceBuffer::Event event;
+    event.phase = 'i';
+    event.category = category;
+    event.typeId = typeId;
+    event.start = now();
+    event.receiver = cachedReceiverName(receiver);
+    QFTraceBuffer::local()->append(event);
+}
+
+void QFProfiler::record(Category category, const QObject *receiver, int typeId, qint64 elapsed)
+{
+    const auto key = RecordKey{category, receiver, typeId};
+    const auto time = quint64(std::max<qint64>(elapsed, 0));
+    auto &data = records();
+
+    auto update = [time](Record *record) {
+        record->count.fetch_add(1, std::memory_order_relaxed);
+        record->totalTime.fetch_add(time, std::memory_order_relaxed);
+        record->histogram[bucketOf(time)].fetch_add(1, std::memory_order_relaxed);
+
+        auto max = record->maxTime.load(std::memory_order_relaxed);
+        while (time > max && !record->maxTime.compare_exchange_weak(max, time, std::memory_order_relaxed)) {}
+    };
+
+    {
+        QReadLocker locker(&data.lock);
+        if (auto record = data.records.value(key); record)
+        {
+            update(record);
+            return;
+        }
+    }
+
+    // The name is resolved once, by the thread owning the receiver.
+    auto name = receiverName(receiver);
+
+    QWriteLocker locker(&data.lock);
+    auto &record = data.records[key];
+    if (!record)
+    {
+        record = new Record();
+        record->receiver = name;
+    }
+    update(record);
+}
+
+/*! \qmlmethod Profiler::reset()
+
+  Discard all the recorded data.
+
+ */
+
+void QFProfiler::reset()
+{
+    auto &data = records();
+
+    QWriteLocker locker(&data.lock);
+    qDeleteAll(data.records);
+    data.records.clear();
+}
+
+/*! \qmlmethod bool Profiler::saveTrace(string fileName)
+
+  Write the trace events of every thread to fileName in Chrome Trace Event JSON format.
+  Timestamps are in microseconds. It returns false if the file could not be written.
+
+ */
+
+bool QFProfiler::saveTrace(const QString &fileName) const
+{
+    QStringList categories;
+    const auto meta = QMetaEnum::fromType<Category>();
+    for (int i = 0 ; i < meta.keyCount(); i++)
+        categories << QString::fromLatin1(meta.key(i));
+
+    QJsonObject root{
+        {QStringLiteral("traceEvents"), QFTraceBuffer::exportAll(categories)},
+        {QStringLiteral("displayTimeUnit"), QStringLiteral("ns")}
+    };
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qWarning() << QStringLiteral("Profiler.saveTrace() - Failed to open %1: %2").arg(fileName, file.errorString());
+        return false;
+    }
+
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+/*! \qmlmethod Profiler::clearTrace()
+
+  Discard all the trace events.
+
+ */
+
+void QFProfiler::clearTrace()
+{
+    QFTraceBuffer::clearAll();
+    cachedReceiverName(nullptr);
+}
+
+/*! \qmlmethod array Profiler::report()
+
+  Return the recorded data, sorted by the total time in descending order.
+  Each entry contains:
+
+  \list
+  \li category - "Queue", "Dispatcher", "Listener", "Store", "Filter" or "Middleware". Queue is the time an action waits before delivery.
+  \li receiver - The objectName or the id of the receiver
+  \li type - The action type
+  \li count - The number of calls
+  \li totalTime, averageTime, maxTime - In microseconds
+  \li histogram - The number of calls per bucket. Bucket i counts the calls taking [2^i, 2^(i+1)) nanoseconds.
+  \endlist
+
+ */
+
+QVariantList QFProfiler::report() const
+{
+    const auto categories = QMetaEnum::fromType<Category>();
+    auto &data = records();
+
+    QVariantList result;
+
+    QReadLocker locker(&data.lock);
+
+    for (auto iter = data.records.cbegin(); iter != data.records.cend(); ++iter)
+    {
+        const auto record = iter.value();
+        const auto count = record->count.load(std::memory_order_relaxed);
+        const auto totalTime = record->totalTime.load(std::memory_order_relaxed);
+
+        QVariantList histogram;
+        for (const auto &bucket : record->histogram)
+            histogram << bucket.load(std::memory_order_relaxed);
+
+        QVariantMap entry;
+        entry[QStringLiteral("category")] = QString::fromLatin1(categories.valueToKey(iter.key().category));
+        entry[QStringLiteral("receiver")] = record->receiver;
+        entry[QStringLiteral("type")] = QFActionTypeRegistry::name(iter.key().typeId);
+        entry[QStringLiteral("count")] = count;
+        entry[QStringLiteral("totalTime")] = totalTime / 1000.0;
+        entry[QStringLiteral("averageTime")] = count > 0 ? totalTime / 1000.0 / count : 0.0;
+        entry[QStringLiteral("maxTime")] = record->maxTime.load(std::memory_order_relaxed) / 1000.0;
+        entry[QStringLiteral("histogram")] = histogram;
+
+        result << entry;
+    }
+
+    std::sort(result.begin(), result.end(), [](const QVariant &a, const QVariant &b) {
+        return a.toMap().value(QStringLiteral("totalTime")).toDouble() > b.toMap().value(QStringLiteral("totalTime")).toDouble();
+    });
+
+    return result;
+}
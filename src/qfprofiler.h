@@ -0,0 +1,97 @@
+#pragma once
+
+#include <QObject>
+#include <QVariantList>
+#include <atomic>
+
+/// Opt-in profiler of action delivery
+/**
+  When enabled, the dispatcher, listeners, stores, filters and middlewares record the number of
+  calls and the time spent per receiver and per action type. When tracing, every call is also kept
+  as a span of a Chrome Trace Event timeline. It is shared by the whole process.
+  When both are disabled, every instrumented call costs a single relaxed atomic load.
+ */
+
+class QFProfiler : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ isEnabledProperty WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool tracing READ isTracingProperty WRITE setTracing NOTIFY tracingChanged)
+
+public:
+    enum Category
+    {
+        Queue,
+        Dispatcher,
+        Listener,
+        Store,
+        Filter,
+        Middleware
+    };
+    Q_ENUM(Category)
+
+    /// Number of histogram buckets. Bucket i counts the calls taking [2^i, 2^(i+1)) nanoseconds.
+    static const int BucketCount = 40;
+
+    static QFProfiler *instance();
+
+    static bool isEnabled()
+    {
+        return s_flags.load(std::memory_order_relaxed) & EnabledFlag;
+    }
+
+    static bool isTracing()
+    {
+        return s_flags.load(std::memory_order_relaxed) & TracingFlag;
+    }
+
+    /// True if either recording or tracing
+    static bool isActive()
+    {
+        return s_flags.load(std::memory_order_relaxed) != 0;
+    }
+
+    /// Monotonic clock in nanoseconds
+    static qint64 now();
+
+    void setEnabled(bool enabled);
+
+    void setTracing(bool tracing);
+
+    /// Record a call of receiver that started and ended at the time given by now()
+    void span(Category category, const QObject *receiver, int typeId, qint64 start, qint64 end);
+
+    /// Add an instant event to the trace
+    void mark(Category category, const QObject *receiver, int typeId);
+
+signals:
+    void enabledChanged();
+    void tracingChanged();
+
+public slots:
+    void reset();
+
+    QVariantList report() const;
+
+    bool saveTrace(const QString &fileName) const;
+
+    void clearTrace();
+
+private:
+    explicit QFProfiler(QObject *parent = nullptr);
+
+    enum Flag
+    {
+        EnabledFlag = 1,
+        TracingFlag = 2
+    };
+
+    void record(Category category, const QObject *receiver, int typeId, qint64 elapsed);
+
+    void setFlag(Flag flag, bool on);
+
+    bool isEnabledProperty() const;
+    bool isTracingProperty() const;
+
+    static std::atomic<int> s_flags;
+};
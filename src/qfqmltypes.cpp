@@ -15,6 +15,9 @@
 #include "qfmiddlewarelist.h"
 #include "qfstore.h"
 #include "qfhydrate.h"
+#include "qfprofiler.h"
+#include "qfratelimiter.h"
+#include "qfpredicate.h"
 
 static QObject *appDispatcherProvider(QQmlEngine *engine, QJSEngine *scriptEngine)
 {
@@ -36,6 +39,17 @@ static QObject* hydrateProvider(QQmlEngine *engine, QJSEngine *scriptEngine)
     return object;
 }
 
+static QObject* profilerProvider(QQmlEngine *engine, QJSEngine *scriptEngine)
+{
+    Q_UNUSED(engine);
+    Q_UNUSED(scriptEngine);
+
+    // It is shared by every engine
+    auto object = QFProfiler::instance();
+    QQmlEngine::setObjectOwnership(object, QQmlEngine::CppOwnership);
+    return object;
+}
+
 
 void registerQuickFluxQmlTypes()
 {
@@ -71,6 +85,11 @@ void registerQuickFluxQmlTypes()
     qmlRegisterType<QFStore>("QuickFlux", 1, 1, "Store");
     qmlRegisterType<QFMiddlewareList>("QuickFlux", 1, 1, "MiddlewareList");
     qmlRegisterType<QFMiddleware>("QuickFlux", 1, 1, "Middleware");
+    qmlRegisterType<QFThrottle>("QuickFlux", 1, 1, "Throttle");
+    qmlRegisterType<QFDebounce>("QuickFlux", 1, 1, "Debounce");
+    qmlRegisterType<QFSample>("QuickFlux", 1, 1, "Sample");
+    qmlRegisterType<QFPredicate>("QuickFlux", 1, 1, "Predicate");
+    qmlRegisterSingletonType<QFProfiler>("QuickFlux", 1, 1, "Profiler", profilerProvider);
     //    qmlRegisterType<QFObject>("QuickFlux", 1, 1, "Object");
 }
 
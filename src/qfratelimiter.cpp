@@ -0,0 +1,265 @@
+#include "qfratelimiter.h"
+#include "priv/qftimerwheel.h"
+
+/*!
+   \qmltype Throttle
+   \inqmlmodule QuickFlux 1.1
+   \brief A built-in middleware that limits the rate of actions
+
+Throttle passes the first action of a group at once, then holds the group for an interval. The last action
+received in the interval is passed when it ends, and another interval is started. A group is an action type,
+or an action type and a value of the message if the key property is set.
+
+\code
+import QuickFlux 1.1
+
+MiddlewareList {
+    applyTarget: AppDispatcher
+
+    Throttle {
+        types: [ActionTypes.scrollTo]
+        interval: 50
+        key: "view"
+    }
+}
+\endcode
+
+Debounce and Sample are the other operators. They share a coarse timer wheel with 10ms resolution,
+so the actual delay is rounded up to it.
+
+The actions passed later are not ordered with the other actions by MiddlewareList.ordering.
+
+ */
+
+/*! \qmlproperty bool Throttle::trailing
+
+  If this property is false, the actions received in the interval are dropped.
+
+  The default value is true
+ */
+
+/*!
+   \qmltype Debounce
+   \inqmlmodule QuickFlux 1.1
+   \brief A built-in middleware that passes an action after a quiet interval
+
+Debounce holds an action until no other action of the same group is received for an interval, then passes the last one.
+It fits the actions fired by typing, e.g. a search query.
+
+\code
+Debounce {
+    types: [ActionTypes.search]
+    interval: 300
+}
+\endcode
+
+ */
+
+/*!
+   \qmltype Sample
+   \inqmlmodule QuickFlux 1.1
+   \brief A built-in middleware that passes the latest action per interval
+
+Sample passes the latest action of a group once every interval, and nothing if no action is received in it.
+
+ */
+
+QFRateLimiter::QFRateLimiter(Mode mode, QObject *parent)
+    : QFNativeMiddleware(parent)
+    , m_trailing(true)
+    , m_mode(mode)
+    , m_interval(100)
+    , m_droppedCount(0)
+{
+}
+
+QFRateLimiter::~QFRateLimiter()
+{
+    auto wheel = QFTimerWheel::local();
+
+    for (const auto &state : m_states)
+        if (state.timer != 0)
+            wheel->cancel(state.timer);
+}
+
+void QFRateLimiter::process(const QString &type, QFActionEnvelope &envelope, const Next &next)
+{
+    Q_UNUSED(type);
+
+    Group group(envelope.typeId(), QString());
+    if (!m_key.isEmpty())
+        group.second = envelope.variant().toMap().value(m_key).toString();
+
+    auto iter = m_states.find(group);
+
+    if (iter == m_states.end())
+    {
+        iter = m_states.insert(group, State());
+
+        if (m_mode == ThrottleMode)
+        {
+            // The leading action
+            startTimer(group, iter.value());
+            next(envelope);
+            return;
+        }
+    }
+
+    auto &state = iter.value();
+
+    if (m_mode == ThrottleMode && !m_trailing)
+    {
+        m_droppedCount++;
+        emit droppedCountChanged();
+        return;
+    }
+
+    hold(state, envelope, next);
+
+    if (m_mode == DebounceMode && state.timer != 0)
+    {
+        QFTimerWheel::local()->cancel(state.timer);
+        state.timer = 0;
+    }
+
+    if (state.timer == 0)
+        startTimer(group, state);
+}
+
+/*! \qmlproperty int Throttle::interval
+
+  The interval in milliseconds. A change is applied to the intervals started later.
+
+  The default value is 100
+ */
+
+/*! \qmlproperty int Debounce::interval
+
+  The quiet interval in milliseconds.
+
+  The default value is 100
+ */
+
+/*! \qmlproperty int Sample::interval
+
+  The sampling interval in milliseconds.
+
+  The default value is 100
+ */
+
+int QFRateLimiter::interval() const
+{
+    return m_interval;
+}
+
+void QFRateLimiter::setInterval(int interval)
+{
+    if (m_interval == interval)
+        return;
+
+    m_interval = interval;
+    emit intervalChanged();
+}
+
+/*! \qmlproperty string Throttle::key
+
+  The name of a message property. If it is set, the actions of a type are grouped by the value of the property,
+  and each group is limited separately, e.g. one per item of a list.
+
+  The default value is an empty string. All the actions of a type are in one group.
+ */
+
+QString QFRateLimiter::key() const
+{
+    return m_key;
+}
+
+void QFRateLimiter::setKey(const QString &key)
+{
+    if (m_key == key)
+        return;
+
+    m_key = key;
+    emit keyChanged();
+}
+
+/*! \qmlproperty int Throttle::droppedCount
+
+  The number of actions dropped or replaced by a later action of the same group. It is read-only.
+ */
+
+int QFRateLimiter::droppedCount() const
+{
+    return m_droppedCount;
+}
+
+void QFRateLimiter::hold(State &state, QFActionEnvelope &envelope, const Next &next)
+{
+    if (state.hasPending)
+    {
+        m_droppedCount++;
+        emit droppedCountChanged();
+    }
+
+    state.pending = envelope;
+    state.hasPending = true;
+
+    // It is passed after process() returns, so the action is not kept in flight
+    state.next = next.detached();
+}
+
+void QFRateLimiter::startTimer(const Group &group, State &state)
+{
+    state.timer = QFTimerWheel::local()->start(m_interval, [this, group]() {
+        timeout(group);
+    });
+}
+
+void QFRateLimiter::timeout(const Group &group)
+{
+    auto iter = m_states.find(group);
+    if (iter == m_states.end())
+        return;
+
+    auto &state = iter.value();
+    state.timer = 0;
+
+    if (!state.hasPending)
+    {
+        m_states.erase(iter);
+        return;
+    }
+
+    const auto envelope = state.pending;
+    const auto next = state.next;
+
+    if (m_mode == DebounceMode)
+    {
+        m_states.erase(iter);
+    }
+    else
+    {
+        state.pending = QFActionEnvelope();
+        state.hasPending = false;
+        state.next = Next();
+        startTimer(group, state);
+    }
+
+    // The chain may dispatch another action to this middleware synchronously
+    next(envelope);
+}
+
+QFThrottle::QFThrottle(QObject *parent)
+    : QFRateLimiter(ThrottleMode, parent)
+{
+}
+
+QFDebounce::QFDebounce(QObject *parent)
+    : QFRateLimiter(DebounceMode, parent)
+{
+}
+
+QFSample::QFSample(QObject *parent)
+    : QFRateLimiter(SampleMode, parent)
+{
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QHash>
+#include <QPair>
+#include "qfnativemiddleware.h"
+
+/// Base class of Throttle, Debounce and Sample
+/**
+  Actions are grouped by type, and by the value of the key property of the message if it is set.
+  The timers of all the groups share a coarse timer wheel.
+ */
+
+class QFRateLimiter : public QFNativeMiddleware
+{
+    Q_OBJECT
+    Q_PROPERTY(int interval READ interval WRITE setInterval NOTIFY intervalChanged)
+    Q_PROPERTY(QString key READ key WRITE setKey NOTIFY keyChanged)
+    Q_PROPERTY(int droppedCount READ droppedCount NOTIFY droppedCountChanged)
+
+public:
+    enum Mode {
+        ThrottleMode,
+        DebounceMode,
+        SampleMode
+    };
+
+    explicit QFRateLimiter(Mode mode, QObject *parent = nullptr);
+    ~QFRateLimiter();
+
+    void process(const QString &type, QFActionEnvelope &envelope, const Next &next) override;
+
+    int interval() const;
+    void setInterval(int interval);
+
+    QString key() const;
+    void setKey(const QString &key);
+
+    int droppedCount() const;
+
+signals:
+    void intervalChanged();
+    void keyChanged();
+    void droppedCountChanged();
+
+protected:
+    // Throttle only. If false, the actions in a window are dropped instead of passing the last one at the end.
+    bool m_trailing;
+
+private:
+    using Group = QPair<int, QString>;
+
+    struct State
+    {
+        int timer = 0;
+        bool hasPending = false;
+        QFActionEnvelope pending;
+        Next next;
+    };
+
+    void hold(State &state, QFActionEnvelope &envelope, const Next &next);
+    void startTimer(const Group &group, State &state);
+    void timeout(const Group &group);
+
+    Mode m_mode;
+    int m_interval;
+    QString m_key;
+    int m_droppedCount;
+
+    QHash<Group, State> m_states;
+};
+
+class QFThrottle : public QFRateLimiter
+{
+    Q_OBJECT
+    Q_PROPERTY(bool trailing MEMBER m_trailing NOTIFY trailingChanged)
+
+public:
+    explicit QFThrottle(QObject *parent = nullptr);
+
+signals:
+    void trailingChanged();
+};
+
+class QFDebounce : public QFRateLimiter
+{
+    Q_OBJECT
+public:
+    explicit QFDebounce(QObject *parent = nullptr);
+};
+
+class QFSample : public QFRateLimiter
+{
+    Q_OBJECT
+public:
+    explicit QFSample(QObject *parent = nullptr);
+};
@@ -1,8 +1,14 @@
+#include <climits>
 #include <QtQml>
 #include <QQmlEngine>
 #include <QFAppDispatcher>
 #include "priv/quickfluxfunctions.h"
+#include "priv/qfactiontyperegistry.h"
+#include "priv/qffilterfunctiontable.h"
+#include "priv/qfnotifyholder.h"
+#include "priv/qfprofilerscope.h"
 #include "qfactioncreator.h"
+#include "qffilter.h"
 #include "qfstore.h"
 
 /*!
@@ -62,6 +68,8 @@
 
 In the example above, the rootStore is bind to AppDispatcher, whatever the dispatcher dispatch an action, it will first re-dispatch the action to its children sequentially. Then emit the dispatched signal on itself. Therefore, the order of receivers is: page1, page2 then filter1.
 
+A child store is skipped if neither it nor any store beneath it handles the action type, by a Filter, a filter function or a handler of the dispatched signal. A store with an onDispatched handler receives every action.
+
 If the redispatchTargets property is set, Store component will also dispatch the received action to the listed objects.
 
 */
@@ -121,48 +129,325 @@ The default value is false
 QFStore::QFStore(QObject *parent)
     : QObject{parent}
     , m_filterFunctionEnabled{false}
+    , m_batchEnabled{false}
+    , m_filterFunctions{nullptr}
+    , m_receiversDirty{true}
+    , m_lastSerial{0}
 {
+    connect(this, &QFStore::filterFunctionEnabledChanged, this, &QFStore::invalidateSummary);
 }
 
 QQmlListProperty<QObject> QFStore::children()
 {
-    return QQmlListProperty<QObject>(this, m_children);
+    return QQmlListProperty<QObject>(this, nullptr, appendChild, childCount, childAt, clearChildren);
 }
 
 void QFStore::dispatch(const QString &type, const QJSValue &message)
 {
+    dispatch(type, QFActionTypeRegistry::intern(type), message, nextSerial());
+}
+
+void QFStore::dispatch(const QString &type, int typeId, const QJSValue &message, qint64 serial)
+{
+    // Reached twice, by a redispatch cycle or by two paths
+    if (m_lastSerial == serial)
+        return;
+
+    m_lastSerial = serial;
+
     auto engine = qmlEngine(this);
     QF_PRECHECK_DISPATCH(engine, type, message);
 
-    for(const auto &child : m_children)
-        if (auto store = qobject_cast<QFStore *>(child))
-            store->dispatch(type, message);
+    // A copy, as a handler may change the lists. Subtrees without any handler of the type are skipped.
+    const auto stores = receivers();
 
-    for(const auto &child : m_redispatchTargets)
-        if ( auto store = qobject_cast<QFStore*>(child))
-            store->dispatch(type, message);
+    for (const auto &store : stores)
+        if (!store.isNull() && store->handles(type, typeId))
+            store->dispatch(type, typeId, message, serial);
+
+    // Children are measured by themselves
+    QFProfilerScope profilerScope(QFProfiler::Store, this, typeId);
 
     if (m_filterFunctionEnabled)
     {
-        const auto meta = metaObject();
+        if (!m_filterFunctions)
+            m_filterFunctions = QFFilterFunctionTable::of(metaObject());
 
-        auto signature = QMetaObject::normalizedSignature(QStringLiteral("%1(QVariant)").arg(type).toUtf8().constData());
-        if (auto index = meta->indexOfMethod(signature.constData()); index >= 0)
-        {
-            auto method = meta->method(index);
-            auto value = QVariant::fromValue<QJSValue>(message);
-            method.invoke(this, Qt::DirectConnection, Q_ARG(QVariant, value));
-        }
+        m_filterFunctions->invoke(this, type, typeId, message);
+    }
+
+    emit dispatched(type, message);
+
+    deliverToFilters(type, typeId, message);
+}
+
+qint64 QFStore::nextSerial()
+{
+    static qint64 serial = 0;
+    return ++serial;
+}
+
+const QVector<QPointer<QFStore>> &QFStore::receivers()
+{
+    if (!m_receiversDirty)
+        return m_receivers;
+
+    m_receivers.clear();
+    m_receiversDirty = false;
+
+    auto add = [this](QObject *object) {
+        auto store = qobject_cast<QFStore *>(object);
+        if (store && store != this && !m_receivers.contains(store))
+            m_receivers.append(store);
+    };
+
+    for (const auto &child : m_children)
+        add(child);
+
+    for (const auto &target : m_redispatchTargets)
+        add(target);
+
+    return m_receivers;
+}
+
+void QFStore::invalidateReceivers()
+{
+    m_receiversDirty = true;
+    invalidateSummary();
+}
+
+void QFStore::addFilter(QFFilter *filter)
+{
+    m_filters.append(filter);
+    invalidateFilterRoutes();
+
+    connect(filter, &QFFilter::typesChanged, this, &QFStore::invalidateFilterRoutes);
+    connect(filter, &QObject::destroyed, this, &QFStore::invalidateFilterRoutes);
+}
+
+void QFStore::invalidateFilterRoutes()
+{
+    m_filterRoutes.clear();
+    invalidateSummary();
+}
+
+void QFStore::invalidateSummary()
+{
+    QSet<QFStore *> visited;
+    invalidateSummary(visited);
+}
+
+void QFStore::invalidateSummary(QSet<QFStore *> &visited)
+{
+    if (visited.contains(this))
+        return;
+
+    visited.insert(this);
+
+    m_summaryKnown.clear();
+    m_summaryHandled.clear();
+
+    for (const auto &store : m_upstream)
+        if (!store.isNull())
+            store->invalidateSummary(visited);
+}
+
+bool QFStore::handles(const QString &type, int typeId)
+{
+    QVector<QFStore *> visiting;
+    int reached = INT_MAX;
+
+    return handles(type, typeId, visiting, reached);
+}
 
-        signature = QMetaObject::normalizedSignature(QStringLiteral("%1()").arg(type).toUtf8().constData());
-        if (auto index = meta->indexOfMethod(signature.constData()); index >= 0)
+bool QFStore::handles(const QString &type, int typeId, QVector<QFStore *> &visiting, int &reached)
+{
+    if (typeId < m_summaryKnown.size() && m_summaryKnown.testBit(typeId))
+        return m_summaryHandled.testBit(typeId);
+
+    // A cycle of redispatch targets. The rest of it is visited by the store on the path.
+    const auto position = visiting.indexOf(this);
+    if (position >= 0)
+    {
+        reached = qMin(reached, position);
+        return false;
+    }
+
+    auto handled = isCatchAll() || !filtersOf(typeId).isEmpty();
+
+    if (!handled && m_filterFunctionEnabled)
+    {
+        if (!m_filterFunctions)
+            m_filterFunctions = QFFilterFunctionTable::of(metaObject());
+
+        handled = m_filterFunctions->contains(metaObject(), type, typeId);
+    }
+
+    if (!handled)
+    {
+        visiting.append(this);
+
+        const auto self = visiting.size() - 1;
+        auto subtreeReached = INT_MAX;
+        const auto stores = receivers();
+
+        for (int i = 0 ; i < stores.size() && !handled; i++)
+            if (!stores.at(i).isNull())
+                handled = stores.at(i)->handles(type, typeId, visiting, subtreeReached);
+
+        visiting.removeLast();
+
+        // The cycle passes a store further up the path, which may still find a handler
+        if (!handled && subtreeReached < self)
         {
-            auto method = meta->method(index);
-            method.invoke(this);
+            reached = qMin(reached, subtreeReached);
+            return false;
         }
     }
 
-    emit dispatched(type, message);
+    if (typeId >= m_summaryKnown.size())
+    {
+        const auto size = qMax(typeId + 1, m_summaryKnown.size() * 2);
+        m_summaryKnown.resize(size);
+        m_summaryHandled.resize(size);
+    }
+
+    m_summaryKnown.setBit(typeId);
+    m_summaryHandled.setBit(typeId, handled);
+
+    return handled;
+}
+
+bool QFStore::isCatchAll() const
+{
+    static const auto dispatchedSignal = QMetaMethod::fromSignal(&QFStore::dispatched);
+    static const auto batchDispatchedSignal = QMetaMethod::fromSignal(&QFStore::batchDispatched);
+
+    return isSignalConnected(dispatchedSignal) || isSignalConnected(batchDispatchedSignal);
+}
+
+void QFStore::connectNotify(const QMetaMethod &signal)
+{
+    if (signal == QMetaMethod::fromSignal(&QFStore::dispatched) ||
+        signal == QMetaMethod::fromSignal(&QFStore::batchDispatched))
+        invalidateSummary();
+}
+
+void QFStore::disconnectNotify(const QMetaMethod &signal)
+{
+    // An invalid signal is passed when all the connections are removed at once
+    if (!signal.isValid() ||
+        signal == QMetaMethod::fromSignal(&QFStore::dispatched) ||
+        signal == QMetaMethod::fromSignal(&QFStore::batchDispatched))
+        invalidateSummary();
+}
+
+void QFStore::watch(QObject *object)
+{
+    if (auto store = qobject_cast<QFStore *>(object))
+    {
+        store->m_upstream.append(this);
+        connect(store, &QObject::destroyed, this, &QFStore::invalidateReceivers);
+    }
+
+    invalidateReceivers();
+}
+
+void QFStore::unwatch(QObject *object)
+{
+    if (auto store = qobject_cast<QFStore *>(object))
+    {
+        store->m_upstream.removeOne(this);
+        disconnect(store, &QObject::destroyed, this, &QFStore::invalidateReceivers);
+    }
+
+    invalidateReceivers();
+}
+
+void QFStore::appendChild(QQmlListProperty<QObject> *list, QObject *object)
+{
+    auto store = static_cast<QFStore *>(list->object);
+    store->m_children.append(object);
+    store->watch(object);
+}
+
+int QFStore::childCount(QQmlListProperty<QObject> *list)
+{
+    return static_cast<QFStore *>(list->object)->m_children.size();
+}
+
+QObject *QFStore::childAt(QQmlListProperty<QObject> *list, int index)
+{
+    return static_cast<QFStore *>(list->object)->m_children.at(index);
+}
+
+void QFStore::clearChildren(QQmlListProperty<QObject> *list)
+{
+    auto store = static_cast<QFStore *>(list->object);
+    const auto children = store->m_children;
+    store->m_children.clear();
+
+    for (const auto &child : children)
+        store->unwatch(child);
+}
+
+void QFStore::appendTarget(QQmlListProperty<QObject> *list, QObject *object)
+{
+    auto store = static_cast<QFStore *>(list->object);
+    store->m_redispatchTargets.append(object);
+    store->watch(object);
+}
+
+int QFStore::targetCount(QQmlListProperty<QObject> *list)
+{
+    return static_cast<QFStore *>(list->object)->m_redispatchTargets.size();
+}
+
+QObject *QFStore::targetAt(QQmlListProperty<QObject> *list, int index)
+{
+    return static_cast<QFStore *>(list->object)->m_redispatchTargets.at(index);
+}
+
+void QFStore::clearTargets(QQmlListProperty<QObject> *list)
+{
+    auto store = static_cast<QFStore *>(list->object);
+    const auto targets = store->m_redispatchTargets;
+    store->m_redispatchTargets.clear();
+
+    for (const auto &target : targets)
+        store->unwatch(target);
+}
+
+void QFStore::deliverToFilters(const QString &type, int typeId, const QJSValue &message)
+{
+    if (m_filters.isEmpty())
+        return;
+
+    // A copy, as a filter may add or change filters
+    const auto filters = filtersOf(typeId);
+
+    for (const auto &filter : filters)
+        if (!filter.isNull())
+            filter->deliver(type, typeId, message);
+}
+
+const QVector<QPointer<QFFilter>> &QFStore::filtersOf(int typeId)
+{
+    auto iter = m_filterRoutes.find(typeId);
+
+    if (iter == m_filterRoutes.end())
+    {
+        m_filters.removeAll(QPointer<QFFilter>());
+
+        QVector<QPointer<QFFilter>> route;
+        for (const auto &filter : m_filters)
+            if (filter->accepts(typeId))
+                route.append(filter);
+
+        iter = m_filterRoutes.insert(typeId, route);
+    }
+
+    return iter.value();
 }
 
 void QFStore::bind(QObject *source)
@@ -195,7 +480,142 @@ void QFStore::setup()
         connect(m_actionCreator.data(), &QFActionCreator::dispatcherChanged, this, &QFStore::setup);
 
     if (!m_dispatcher.isNull())
-        connect(dispatcher, &QFDispatcher::dispatched, this, &QFStore::dispatch);
+        connect(dispatcher, &QFDispatcher::dispatched, this, &QFStore::receive);
+
+    if (!m_dispatcher.isNull() && m_batchEnabled)
+        connect(dispatcher, &QFDispatcher::batchDispatched, this, qOverload<const QJSValue &>(&QFStore::dispatchBatch));
+}
+
+void QFStore::receive(const QString &type, const QJSValue &message)
+{
+    // It will receive the whole batch
+    if (m_batchEnabled && !m_dispatcher.isNull() && m_dispatcher->isBatching())
+        return;
+
+    dispatch(type, message);
+}
+
+/*! \qmlmethod Store::dispatchBatch(array actions)
+
+  Dispatch a list of actions, each an object with type and message, as a single batch.
+
+  The child stores and redispatch targets receive the batch first. Then the filter functions and
+  the Filter children receive every action in order. Meanwhile, the change signals of the properties
+  declared in QML are held from QML bindings and signal handlers. Each one emitted during the batch is
+  emitted once after it, even if the value is changed in place or set back. Other signals, and C++
+  connections, are not held. Then the batchDispatched signal is emitted instead of a dispatched signal
+  per action.
+
+  A store with batchEnabled receives batches from a Dispatcher in batched mode by this method.
+ */
+
+void QFStore::dispatchBatch(const QJSValue &actions)
+{
+    dispatchBatch(actions, nextSerial());
+}
+
+void QFStore::dispatchBatch(const QJSValue &actions, qint64 serial)
+{
+    if (m_lastSerial == serial)
+        return;
+
+    m_lastSerial = serial;
+
+    const int count = actions.property("length").toInt();
+
+    QVector<QPair<QString, int>> types;
+    for (int i = 0 ; i < count; i++)
+    {
+        const auto type = actions.property(quint32(i)).property("type").toString();
+        types.append(qMakePair(type, QFActionTypeRegistry::intern(type)));
+    }
+
+    auto handlesBatch = [&types](QFStore *store) {
+        for (const auto &type : types)
+            if (store->handles(type.first, type.second))
+                return true;
+        return false;
+    };
+
+    const auto stores = receivers();
+
+    for (const auto &store : stores)
+        if (!store.isNull() && handlesBatch(store.data()))
+            store->dispatchBatch(actions, serial);
+
+    // Only the change signals of the properties declared in QML are held
+    QFNotifyHolder holder(this, QFStore::staticMetaObject.propertyCount());
+
+    for (int i = 0 ; i < count; i++)
+    {
+        const auto &type = types.at(i).first;
+        const auto typeId = types.at(i).second;
+        const auto message = actions.property(quint32(i)).property("message");
+
+        QFProfilerScope profilerScope(QFProfiler::Store, this, typeId);
+
+        if (m_filterFunctionEnabled)
+        {
+            if (!m_filterFunctions)
+                m_filterFunctions = QFFilterFunctionTable::of(metaObject());
+
+            m_filterFunctions->invoke(this, type, typeId, message);
+        }
+
+        // Filters are called directly, not by the dispatched signal
+        deliverToFilters(type, typeId, message);
+    }
+
+    holder.release();
+
+    emit batchDispatched(actions);
+}
+
+/*! \qmlproperty bool Store::batchEnabled
+
+  If this property is true and the bound Dispatcher is in batched mode, the store receives every batch by
+  dispatchBatch() instead of one action at a time. The property change signals of the store are emitted once per batch.
+
+  \code
+
+  Store {
+    bindSource: dispatcher
+    batchEnabled: true
+
+    property int total: 0
+
+    Filter {
+      type: ActionTypes.add
+      onDispatched: total += message.value // onTotalChanged is emitted once per batch
+    }
+  }
+
+  \endcode
+
+  The default value is false
+ */
+
+bool QFStore::batchEnabled() const
+{
+    return m_batchEnabled;
+}
+
+void QFStore::setBatchEnabled(bool batchEnabled)
+{
+    if (m_batchEnabled == batchEnabled)
+        return;
+
+    m_batchEnabled = batchEnabled;
+
+    if (!m_dispatcher.isNull())
+    {
+        if (m_batchEnabled)
+            connect(m_dispatcher.data(), &QFDispatcher::batchDispatched, this, qOverload<const QJSValue &>(&QFStore::dispatchBatch), Qt::UniqueConnection);
+        else
+            disconnect(m_dispatcher.data(), &QFDispatcher::batchDispatched, this, qOverload<const QJSValue &>(&QFStore::dispatchBatch));
+    }
+
+    emit batchEnabledChanged();
 }
 
 /*! \qmlproperty array Store::redispatchTargets
@@ -203,6 +623,9 @@ void QFStore::setup()
   By default, the Store component redispatch the received action to its children sequentially. If this property is set,
   the action will be re-dispatch to the target objects too.
 
+  A store is delivered an action once, even if it is reachable more than once, e.g. as a child and a target,
+  or by a cycle of targets.
+
   \code
 
     Store {
@@ -220,7 +643,7 @@ void QFStore::setup()
 
 QQmlListProperty<QObject> QFStore::redispatchTargets()
 {
-    return QQmlListProperty<QObject>(this, m_redispatchTargets);
+    return QQmlListProperty<QObject>(this, nullptr, appendTarget, targetCount, targetAt, clearTargets);
 }
 
 
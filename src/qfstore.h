@@ -5,10 +5,17 @@
 #include <QQmlListProperty>
 #include <QJSValue>
 #include <QPointer>
+#include <QHash>
+#include <QVector>
+#include <QBitArray>
+#include <QSet>
 #include <QQmlParserStatus>
 #include "qfactioncreator.h"
 #include "qfdispatcher.h"
 
+class QFFilterFunctionTable;
+class QFFilter;
+
 class QFStore : public QObject
 {
     Q_OBJECT
@@ -16,6 +23,7 @@ class QFStore : public QObject
     Q_PROPERTY(QQmlListProperty<QObject> children READ children)
     Q_PROPERTY(QQmlListProperty<QObject> redispatchTargets READ redispatchTargets)
     Q_PROPERTY(bool filterFunctionEnabled MEMBER m_filterFunctionEnabled NOTIFY filterFunctionEnabledChanged)
+    Q_PROPERTY(bool batchEnabled READ batchEnabled WRITE setBatchEnabled NOTIFY batchEnabledChanged)
 
     Q_CLASSINFO("DefaultProperty", "children")
 
@@ -27,30 +35,119 @@ public:
     void setBindSource(QObject* source);
     QQmlListProperty<QObject> redispatchTargets();
 
+    bool batchEnabled() const;
+    void setBatchEnabled(bool batchEnabled);
+
 signals:
     void dispatched(const QString &type, const QJSValue &message);
     void bindSourceChanged();
     void filterFunctionEnabledChanged();
+    void batchEnabledChanged();
+    void batchDispatched(const QJSValue &actions);
 
 public slots:
     void dispatch(const QString &type, const QJSValue &message = QJSValue());
     void bind(QObject* source);
+    void dispatchBatch(const QJSValue &actions);
 
 
 protected:
     void classBegin();
     void componentComplete();
 
+    void connectNotify(const QMetaMethod &signal) override;
+    void disconnectNotify(const QMetaMethod &signal) override;
+
 private slots:
     void setup();
 
+    // Receive an action from the bound dispatcher
+    void receive(const QString &type, const QJSValue &message);
+
+    void invalidateFilterRoutes();
+
+    // Something beneath this store is changed. The stores above are invalidated too.
+    void invalidateSummary();
+
 private:
+    friend class QFFilter;
+
+    // The stores above may cache a result derived through this store, even if this store has none.
+    // Every store above is visited once.
+    void invalidateSummary(QSet<QFStore *> &visited);
+
+    // The serial identifies an action delivered through the tree. A store reached again by it is skipped.
+    void dispatch(const QString &type, int typeId, const QJSValue &message, qint64 serial);
+    void dispatchBatch(const QJSValue &actions, qint64 serial);
+
+    static qint64 nextSerial();
+
+    // The child stores and redispatch targets without duplicates, in delivery order
+    const QVector<QPointer<QFStore>> &receivers();
+
+    void invalidateReceivers();
+
+    // Register a Filter child. It is called by dispatch() directly instead of listening to the dispatched signal.
+    void addFilter(QFFilter *filter);
+
+    void deliverToFilters(const QString &type, int typeId, const QJSValue &message);
+
+    // The registered filters interested in the type, in registration order
+    const QVector<QPointer<QFFilter>> &filtersOf(int typeId);
+
+    // True if an action of the type may be handled by this store or any store it redispatches to
+    bool handles(const QString &type, int typeId);
+
+    // The stores on the path of the query are in visiting. If a store on it is reached again through a cycle,
+    // reached is lowered to its position, and a false result below that position is not cached.
+    bool handles(const QString &type, int typeId, QVector<QFStore *> &visiting, int &reached);
+
+    // True if the dispatched or batchDispatched signal is connected, e.g. by an onDispatched handler
+    bool isCatchAll() const;
+
+    // Track a child store or redispatch target, so its changes invalidate the summary of this store
+    void watch(QObject *object);
+    void unwatch(QObject *object);
+
+    static void appendChild(QQmlListProperty<QObject> *list, QObject *object);
+    static int childCount(QQmlListProperty<QObject> *list);
+    static QObject *childAt(QQmlListProperty<QObject> *list, int index);
+    static void clearChildren(QQmlListProperty<QObject> *list);
+
+    static void appendTarget(QQmlListProperty<QObject> *list, QObject *object);
+    static int targetCount(QQmlListProperty<QObject> *list);
+    static QObject *targetAt(QQmlListProperty<QObject> *list, int index);
+    static void clearTargets(QQmlListProperty<QObject> *list);
+
     QObjectList m_children;
     QPointer<QObject> m_bindSource;
     QPointer<QFActionCreator> m_actionCreator;
     QPointer<QFDispatcher> m_dispatcher;
     QObjectList m_redispatchTargets;
     bool m_filterFunctionEnabled;
+    bool m_batchEnabled;
+    QFFilterFunctionTable *m_filterFunctions;
+
+    // In registration order
+    QVector<QPointer<QFFilter>> m_filters;
+
+    // Filters by action type id. It is cleared when a filter is added, removed or its types are changed.
+    QHash<int, QVector<QPointer<QFFilter>>> m_filterRoutes;
+
+    // Summary of the action types handled by the subtree, indexed by type id. A type is resolved
+    // on the first dispatch and cached until invalidateSummary().
+    QBitArray m_summaryKnown;
+    QBitArray m_summaryHandled;
+
+    // Stores that redispatch to this store, as a child or a target
+    QVector<QPointer<QFStore>> m_upstream;
+
+    // Rebuilt when the children or redispatchTargets list is changed
+    QVector<QPointer<QFStore>> m_receivers;
+    bool m_receiversDirty;
+
+    // Serial of the last action delivered to this store
+    qint64 m_lastSerial;
 
 };
 
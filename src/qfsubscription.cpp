@@ -0,0 +1,58 @@
+#include "qfsubscription.h"
+#include "qfdispatcher.h"
+
+QFSubscription::QFSubscription()
+    : m_id{0}
+{
+}
+
+QFSubscription::QFSubscription(QFDispatcher *dispatcher, int id)
+    : m_dispatcher{dispatcher}
+    , m_id{id}
+{
+}
+
+QFSubscription::QFSubscription(QFSubscription &&other) noexcept
+    : m_dispatcher{other.m_dispatcher}
+    , m_id{other.m_id}
+{
+    other.m_dispatcher.clear();
+    other.m_id = 0;
+}
+
+QFSubscription::~QFSubscription()
+{
+    unsubscribe();
+}
+
+QFSubscription &QFSubscription::operator=(QFSubscription &&other) noexcept
+{
+    if (this != &other)
+    {
+        unsubscribe();
+
+        m_dispatcher = other.m_dispatcher;
+        m_id = other.m_id;
+
+        other.m_dispatcher.clear();
+        other.m_id = 0;
+    }
+
+    return *this;
+}
+
+/// Returns true if the callback is still registered on a living dispatcher
+bool QFSubscription::isActive() const
+{
+    return !m_dispatcher.isNull() && m_id != 0;
+}
+
+/// Remove the callback from the dispatcher. It is safe to call it more than once.
+void QFSubscription::unsubscribe()
+{
+    if (!m_dispatcher.isNull() && m_id != 0)
+        m_dispatcher->unsubscribe(m_id);
+
+    m_dispatcher.clear();
+    m_id = 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QPointer>
+
+class QFDispatcher;
+
+/// A handle of a native subscription created by QFDispatcher::subscribe()
+/**
+  The callback is removed when the handle is destroyed or unsubscribe() is called.
+  The handle could be moved but not copied.
+ */
+
+class QFSubscription
+{
+public:
+    QFSubscription();
+    QFSubscription(QFSubscription &&other) noexcept;
+    ~QFSubscription();
+
+    QFSubscription &operator=(QFSubscription &&other) noexcept;
+
+    QFSubscription(const QFSubscription &) = delete;
+    QFSubscription &operator=(const QFSubscription &) = delete;
+
+    bool isActive() const;
+
+    void unsubscribe();
+
+private:
+    friend class QFDispatcher;
+
+    QFSubscription(QFDispatcher *dispatcher, int id);
+
+    QPointer<QFDispatcher> m_dispatcher;
+
+    int m_id;
+};
@@ -1,5 +1,8 @@
 INCLUDEPATH += $$PWD
 
+# Store batches hold property change signals by a hook in the private API of QtCore
+QT += core-private
+
 HEADERS += \
     $$PWD/qfapplistener.h \
     $$PWD/qfappscript.h \
@@ -24,7 +27,23 @@ HEADERS += \
     $$PWD/qfstore.h \
     $$PWD/qfhydrate.h \
     $$PWD/qfmiddleware.h \
-    $$PWD/qfmiddlewarelist.h
+    $$PWD/qfmiddlewarelist.h \
+    $$PWD/priv/qfactiontyperegistry.h \
+    $$PWD/priv/qfmpscqueue.h \
+    $$PWD/priv/qffilterfunctiontable.h \
+    $$PWD/qfsubscription.h \
+    $$PWD/priv/qfactionenvelope.h \
+    $$PWD/qfprofiler.h \
+    $$PWD/priv/qfprofilerscope.h \
+    $$PWD/priv/qftracebuffer.h \
+    $$PWD/qfnativemiddleware.h \
+    $$PWD/QFNativeMiddleware \
+    $$PWD/priv/qftimerwheel.h \
+    $$PWD/qfratelimiter.h \
+    $$PWD/priv/qfringbuffer.h \
+    $$PWD/priv/qfactiontypepatterns.h \
+    $$PWD/qfpredicate.h \
+    $$PWD/priv/qfnotifyholder.h
 
 SOURCES += \
     $$PWD/qfapplistener.cpp \
@@ -47,4 +66,16 @@ SOURCES += \
     $$PWD/qfstore.cpp \
     $$PWD/qfhydrate.cpp \
     $$PWD/qfmiddleware.cpp \
-    $$PWD/qfmiddlewarelist.cpp
+    $$PWD/qfmiddlewarelist.cpp \
+    $$PWD/priv/qfactiontyperegistry.cpp \
+    $$PWD/priv/qffilterfunctiontable.cpp \
+    $$PWD/qfsubscription.cpp \
+    $$PWD/priv/qfactionenvelope.cpp \
+    $$PWD/qfprofiler.cpp \
+    $$PWD/priv/qftracebuffer.cpp \
+    $$PWD/qfnativemiddleware.cpp \
+    $$PWD/priv/qftimerwheel.cpp \
+    $$PWD/qfratelimiter.cpp \
+    $$PWD/priv/qfactiontypepatterns.cpp \
+    $$PWD/qfpredicate.cpp \
+    $$PWD/priv/qfnotifyholder.cpp
@@ -0,0 +1,14 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+
+/// Count the calls to the global operator new made by the test program.
+
+namespace AllocationCounter {
+
+    quint64 count();
+
+}
+
+#endif // ALLOCATIONCOUNTER_H
@@ -0,0 +1,88 @@
+import QtQuick 2.0
+import QtTest 1.0
+import QuickFlux 1.0
+
+TestCase {
+    name : "AppDispatcher_routing"
+
+    property var seq : new Array;
+
+    AppListener {
+        id: listener1
+        filter: "routing1"
+        onDispatched: {
+            seq.push("listener1");
+        }
+    }
+
+    AppListener {
+        id: listener2
+        filters: ["routing1", "routing2"]
+        onDispatched: {
+            seq.push("listener2:" + type);
+        }
+    }
+
+    AppListener {
+        id: listener3
+        filter: "routing2"
+
+        Component.onCompleted: {
+            on("routing3", function() {
+                seq.push("listener3");
+            });
+        }
+    }
+
+    AppListener {
+        id: listener4
+        onDispatched: {
+            if (type.indexOf("routing") === 0) {
+                seq.push("listener4");
+            }
+        }
+    }
+
+    AppScript {
+        id: script1
+        runWhen: "routing4"
+        script: {
+            seq.push("script1");
+        }
+    }
+
+    // Listeners are registered in reverse order of declaration as componentComplete() is called from the last object.
+
+    function test_routing() {
+        seq = new Array;
+        AppDispatcher.dispatch("routing1");
+        compare(seq, ["listener4", "listener2:routing1", "listener1"]);
+
+        seq = new Array;
+        AppDispatcher.dispatch("routing3");
+        compare(seq, ["listener4", "listener3"]);
+
+        seq = new Array;
+        AppDispatcher.dispatch("routing4");
+        compare(seq, ["script1", "listener4"]);
+
+        seq = new Array;
+        listener1.filter = "routing4";
+        AppDispatcher.dispatch("routing1");
+        compare(seq, ["listener4", "listener2:routing1"]);
+        listener1.filter = "routing1";
+    }
+
+    function test_waitFor_uninterested() {
+        // listener4 waits for listener3, which does not handle routing1 but waits for listener1
+        listener4.waitFor = [listener3.listenerId];
+        listener3.waitFor = [listener1.listenerId];
+
+        seq = new Array;
+        AppDispatcher.dispatch("routing1");
+        compare(seq, ["listener1", "listener4", "listener2:routing1"]);
+
+        listener4.waitFor = [];
+        listener3.waitFor = [];
+    }
+}
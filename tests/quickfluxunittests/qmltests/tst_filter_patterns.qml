@@ -0,0 +1,63 @@
+import QtQuick 2.0
+import QtTest 1.0
+import QuickFlux 1.1
+
+TestCase {
+    name : "Filter_Patterns"
+
+    property var received: new Array
+
+    Store {
+        id: store
+
+        Filter {
+            types: ["photo/*"]
+            onDispatched: received.push("photo:" + type);
+        }
+
+        Filter {
+            types: ["nav/back", "nav/?o"]
+            onDispatched: received.push("nav:" + type);
+        }
+    }
+
+    AppListener {
+        filters: ["pattern/*"]
+        onDispatched: received.push("listener:" + type);
+    }
+
+    AppScript {
+        id: script
+        runWhen: "pattern/start*"
+        script: {
+            received.push("script:" + message.value);
+        }
+    }
+
+    function test_filter() {
+        received = [];
+        store.dispatch("photo/load");
+        store.dispatch("photo/loaded");
+        store.dispatch("nav/back");
+        store.dispatch("nav/go");
+        store.dispatch("nav/forward");
+        store.dispatch("photos");
+        compare(received, ["photo:photo/load", "photo:photo/loaded", "nav:nav/back", "nav:nav/go"]);
+    }
+
+    function test_appListener() {
+        received = [];
+        AppDispatcher.dispatch("pattern/a");
+        AppDispatcher.dispatch("other/a");
+        compare(received, ["listener:pattern/a"]);
+    }
+
+    function test_appScript() {
+        received = [];
+        AppDispatcher.dispatch("pattern/startNow", {value: 1});
+        compare(received.length, 2);
+        verify(received.indexOf("listener:pattern/startNow") >= 0);
+        verify(received.indexOf("script:1") >= 0);
+        script.exit(0);
+    }
+}
@@ -0,0 +1,96 @@
+import QtQuick 2.0
+import QtTest 1.0
+import QuickFlux 1.1
+
+TestCase {
+    name : "Filter_Predicate"
+
+    property var received: new Array
+
+    Store {
+        id: store
+        property int currentId: 1
+
+        Filter {
+            id: lateFilter
+            type: "late"
+            onDispatched: received.push("late:" + message.value);
+        }
+
+        Filter {
+            type: "update"
+
+            Predicate {
+                path: "item.id"
+                equals: store.currentId
+            }
+
+            onDispatched: received.push("update:" + message.item.id);
+        }
+
+        Filter {
+            type: "select"
+
+            Predicate {
+                path: "tab"
+                oneOf: ["home", "search"]
+            }
+
+            Predicate {
+                path: "index"
+                min: 0
+                max: 9
+            }
+
+            onDispatched: received.push("select:" + message.tab + message.index);
+        }
+    }
+
+    function test_equals() {
+        received = [];
+        store.dispatch("update", {item: {id: 1}});
+        store.dispatch("update", {item: {id: 2}});
+        store.dispatch("update", {item: {id: "1"}});
+        store.dispatch("update", {});
+        compare(received, ["update:1"]);
+
+        // The bound value is followed
+        received = [];
+        store.currentId = 2;
+        store.dispatch("update", {item: {id: 1}});
+        store.dispatch("update", {item: {id: 2}});
+        compare(received, ["update:2"]);
+        store.currentId = 1;
+    }
+
+    function test_oneOfAndRange() {
+        received = [];
+        store.dispatch("select", {tab: "home", index: 0});
+        store.dispatch("select", {tab: "search", index: 9});
+        store.dispatch("select", {tab: "other", index: 1});
+        store.dispatch("select", {tab: "home", index: 10});
+        store.dispatch("select", {tab: "home", index: -1});
+        store.dispatch("select", {tab: "home", index: "1"});
+        compare(received, ["select:home0", "select:search9"]);
+    }
+
+    function test_addedLater() {
+        received = [];
+        store.dispatch("late", {value: 1});
+        compare(received, ["late:1"]);
+
+        var predicate = Qt.createQmlObject('import QuickFlux 1.1; Predicate { path: "value"; equals: 2 }', lateFilter);
+
+        received = [];
+        store.dispatch("late", {value: 1});
+        store.dispatch("late", {value: 2});
+        compare(received, ["late:2"]);
+
+        predicate.destroy();
+        wait(0);
+
+        received = [];
+        store.dispatch("late", {value: 1});
+        compare(received, ["late:1"]);
+    }
+}
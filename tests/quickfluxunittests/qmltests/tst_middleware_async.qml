@@ -0,0 +1,154 @@
+import QtQuick 2.0
+import QtTest 1.0
+import QuickFlux 1.1
+
+TestCase {
+    id: testCase
+    name : "Middleware_Async"
+
+    Dispatcher {
+        id: dispatcher
+    }
+
+    MiddlewareList {
+        id: middlewares
+        applyTarget: dispatcher
+
+        Middleware {
+            id: loader
+
+            property var callbacks: []
+
+            function load() {
+                return new Promise(function(resolve) {
+                    loader.callbacks.push(resolve);
+                });
+            }
+
+            function dispatch(type, message, next) {
+                if (type !== "load") {
+                    next(type, message);
+                    return;
+                }
+
+                return load().then(function(value) {
+                    next(type, {value: value});
+                });
+            }
+        }
+    }
+
+    Store {
+        id: store
+        bindSource: dispatcher
+        property var actions : new Array
+        property var actionsAfterWait : new Array
+
+        onDispatched: {
+            store.actions.push(type === "load" ? type + ":" + message.value : type);
+
+            if (type === "wait") {
+                // The load is resolved in a nested event loop, like a modal dialog
+                loader.callbacks[0]("a");
+                testCase.wait(20);
+                store.actionsAfterWait = store.actions.slice();
+            }
+        }
+    }
+
+    Dispatcher {
+        id: legacyDispatcher
+    }
+
+    MiddlewareList {
+        applyTarget: legacyDispatcher
+
+        Middleware {
+            id: legacyLoader
+
+            property var callbacks: []
+
+            // next() of the Middleware instead of the bound one
+            function dispatch(type, message) {
+                if (type !== "load") {
+                    next(type, message);
+                    return;
+                }
+
+                return new Promise(function(resolve) {
+                    legacyLoader.callbacks.push(resolve);
+                }).then(function(value) {
+                    next(type, {value: value});
+                });
+            }
+        }
+    }
+
+    Store {
+        id: legacyStore
+        bindSource: legacyDispatcher
+        property var actions : new Array
+
+        onDispatched: {
+            legacyStore.actions.push(type === "load" ? type + ":" + message.value : type);
+        }
+    }
+
+    function test_strictFifo() {
+        store.actions = [];
+        loader.callbacks = [];
+        middlewares.ordering = MiddlewareList.StrictFifo;
+
+        dispatcher.dispatch("load");
+        dispatcher.dispatch("load");
+        dispatcher.dispatch("other");
+        compare(store.actions, []);
+        compare(loader.callbacks.length, 2);
+
+        // The second load finishes first, but it waits for the first one.
+        loader.callbacks[1]("b");
+        wait(0);
+        compare(store.actions, []);
+
+        loader.callbacks[0]("a");
+        tryCompare(store, "actions", ["load:a", "load:b", "other"]);
+    }
+
+    function test_perTypeFifo() {
+        store.actions = [];
+        loader.callbacks = [];
+        middlewares.ordering = MiddlewareList.PerTypeFifo;
+
+        dispatcher.dispatch("load");
+        dispatcher.dispatch("other");
+        compare(store.actions, ["other"]);
+
+        loader.callbacks[0]("a");
+        tryCompare(store, "actions", ["other", "load:a"]);
+    }
+
+    function test_nestedEventLoop() {
+        store.actions = [];
+        loader.callbacks = [];
+        middlewares.ordering = MiddlewareList.PerTypeFifo;
+
+        dispatcher.dispatch("load");
+        dispatcher.dispatch("wait");
+
+        // The resolved load waits until the current action is delivered
+        compare(store.actionsAfterWait, ["wait"]);
+        tryCompare(store, "actions", ["wait", "load:a"]);
+    }
+
+    function test_legacyNext() {
+        legacyStore.actions = [];
+        legacyLoader.callbacks = [];
+
+        legacyDispatcher.dispatch("load");
+        legacyDispatcher.dispatch("other");
+        compare(legacyStore.actions, []);
+
+        legacyLoader.callbacks[0]("a");
+        tryCompare(legacyStore, "actions", ["load:a", "other"]);
+    }
+}
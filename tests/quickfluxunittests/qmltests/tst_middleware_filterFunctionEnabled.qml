@@ -9,6 +9,8 @@ TestCase {
         id: actions
 
         signal test1();
+
+        signal test2();
     }
 
     MiddlewareList {
@@ -26,6 +28,12 @@ TestCase {
                 next("test1", message);
             }
 
+            // A function held by a property works as a filter function too
+            property var test2: function(message) {
+                middleware1.actions.push("test2");
+                middleware1.next("test2", message);
+            }
+
             function dispatch(type , message) {
             }
         }
@@ -51,11 +59,8 @@ TestCase {
 
     function test_basic() {
         compare(middlewares.data.length, 2);
-        compare(middleware1._nextCallback, undefined); // It won't set the next function until the middleware is applied
 
         middlewares.apply(actions);
-        compare(typeof middleware1._nextCallback, "function");
-        compare(typeof middleware2._nextCallback, "function");
 
         actions.test1();
 
@@ -64,4 +69,15 @@ TestCase {
 
     }
 
+    function test_functionProperty() {
+        middlewares.apply(actions);
+        middleware1.actions = [];
+        listener1.actions = [];
+
+        actions.test2();
+
+        compare(middleware1.actions, ["test2"]);
+        compare(listener1.actions, ["test2","test2"]);
+    }
+
 }
@@ -0,0 +1,115 @@
+import QtQuick 2.0
+import QtTest 1.0
+import QuickFlux 1.1
+
+TestCase {
+    name : "Middleware_RateLimit"
+
+    Dispatcher {
+        id: dispatcher
+    }
+
+    MiddlewareList {
+        applyTarget: dispatcher
+
+        Throttle {
+            id: throttle
+            types: ["scroll"]
+            interval: 50
+            key: "view"
+        }
+
+        Debounce {
+            id: debounce
+            types: ["search"]
+            interval: 50
+        }
+
+        Sample {
+            id: sample
+            types: ["progress"]
+            interval: 50
+        }
+    }
+
+    Store {
+        id: store
+        bindSource: dispatcher
+        property var actions : new Array
+
+        onDispatched: {
+            store.actions.push(type + ":" + message.value);
+        }
+    }
+
+    function test_throttle() {
+        store.actions = [];
+
+        dispatcher.dispatch("scroll", {view: "a", value: 1});
+        dispatcher.dispatch("scroll", {view: "a", value: 2});
+        dispatcher.dispatch("scroll", {view: "b", value: 1});
+        dispatcher.dispatch("scroll", {view: "a", value: 3});
+        compare(store.actions, ["scroll:1", "scroll:1"]);
+
+        tryCompare(store, "actions", ["scroll:1", "scroll:1", "scroll:3"]);
+        compare(throttle.droppedCount, 1);
+    }
+
+    function test_throttle_secondWindow() {
+        store.actions = [];
+        throttle.interval = 500;
+        wait(100);
+
+        dispatcher.dispatch("scroll", {view: "a", value: 1});
+        dispatcher.dispatch("scroll", {view: "a", value: 2});
+        tryCompare(store, "actions", ["scroll:1", "scroll:2"]);
+
+        // The trailing action starts another window
+        dispatcher.dispatch("scroll", {view: "a", value: 3});
+        compare(store.actions, ["scroll:1", "scroll:2"]);
+
+        tryCompare(store, "actions", ["scroll:1", "scroll:2", "scroll:3"]);
+
+        throttle.interval = 50;
+        wait(600);
+    }
+
+    function test_throttle_noTrailing() {
+        store.actions = [];
+        throttle.trailing = false;
+        wait(100);
+
+        dispatcher.dispatch("scroll", {view: "a", value: 1});
+        dispatcher.dispatch("scroll", {view: "a", value: 2});
+        wait(100);
+        compare(store.actions, ["scroll:1"]);
+
+        throttle.trailing = true;
+    }
+
+    function test_debounce() {
+        store.actions = [];
+
+        dispatcher.dispatch("search", {value: "q"});
+        dispatcher.dispatch("search", {value: "qu"});
+        dispatcher.dispatch("search", {value: "qui"});
+        compare(store.actions, []);
+
+        tryCompare(store, "actions", ["search:qui"]);
+        compare(debounce.droppedCount, 2);
+    }
+
+    function test_sample() {
+        store.actions = [];
+
+        dispatcher.dispatch("progress", {value: 1});
+        dispatcher.dispatch("progress", {value: 2});
+        compare(store.actions, []);
+
+        tryCompare(store, "actions", ["progress:2"]);
+
+        // Nothing is passed for an interval without action
+        wait(100);
+        compare(store.actions, ["progress:2"]);
+    }
+}
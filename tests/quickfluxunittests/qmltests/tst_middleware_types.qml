@@ -0,0 +1,71 @@
+import QtQuick 2.0
+import QtTest 1.0
+import QuickFlux 1.1
+
+TestCase {
+    name : "Middleware_Types"
+
+    Dispatcher {
+        id: dispatcher
+    }
+
+    MiddlewareList {
+        id: middlewares
+        applyTarget: dispatcher
+
+        Middleware  {
+            id: middleware1
+
+            property var actions : new Array
+
+            types: ["test1"]
+
+            function dispatch(type , message) {
+                middleware1.actions.push(type);
+                next(type, message);
+            }
+        }
+
+        Middleware {
+            id: middleware2
+
+            property var actions : new Array
+
+            filterFunctionEnabled: true
+
+            function test2(message) {
+                middleware2.actions.push("test2");
+                next("test2", message);
+            }
+        }
+    }
+
+    Store {
+        id: listener1
+        bindSource: dispatcher
+        property var actions : new Array
+
+        onDispatched: {
+            listener1.actions.push(type);
+        }
+    }
+
+    function test_types() {
+        middleware1.actions = [];
+        middleware2.actions = [];
+        listener1.actions = [];
+
+        dispatcher.dispatch("test1");
+        dispatcher.dispatch("test2");
+        dispatcher.dispatch("test3");
+
+        compare(middleware1.actions, ["test1"]);
+        compare(middleware2.actions, ["test2"]);
+        compare(listener1.actions, ["test1", "test2", "test3"]);
+
+        middleware1.types = [];
+        dispatcher.dispatch("test3");
+        compare(middleware1.actions, ["test1", "test3"]);
+        compare(listener1.actions, ["test1", "test2", "test3", "test3"]);
+    }
+}
@@ -0,0 +1,70 @@
+import QtQuick 2.0
+import QtTest 1.0
+import QuickFlux 1.1
+
+TestCase {
+    name : "ProfilerTests"
+
+    Dispatcher {
+        id: dispatcher
+    }
+
+    Store {
+        id: profiledStore
+        bindSource: dispatcher
+
+        Filter {
+            id: profiledFilter
+            type: "profiler.test"
+            onDispatched: {
+                profiledStore.count++;
+            }
+        }
+
+        property int count: 0
+    }
+
+    function find(report, category, receiver) {
+        for (var i = 0 ; i < report.length; i++) {
+            var entry = report[i];
+            if (entry.category === category && entry.receiver === receiver && entry.type === "profiler.test") {
+                return entry;
+            }
+        }
+        return undefined;
+    }
+
+    function cleanup() {
+        Profiler.enabled = false;
+        Profiler.reset();
+    }
+
+    function test_disabled() {
+        compare(Profiler.enabled, false);
+        dispatcher.dispatch("profiler.test");
+        compare(find(Profiler.report(), "Store", "profiledStore"), undefined);
+    }
+
+    function test_report() {
+        Profiler.reset();
+        Profiler.enabled = true;
+
+        dispatcher.dispatch("profiler.test");
+        dispatcher.dispatch("profiler.test");
+
+        var report = Profiler.report();
+
+        var store = find(report, "Store", "profiledStore");
+        compare(store.count, 2);
+        compare(store.totalTime >= 0, true);
+        compare(store.histogram.length, 40);
+
+        var filter = find(report, "Filter", "profiledFilter");
+        compare(filter.count, 2);
+
+        compare(find(report, "Dispatcher", "dispatcher").count, 2);
+
+        Profiler.reset();
+        compare(Profiler.report().length, 0);
+    }
+}
@@ -0,0 +1,73 @@
+import QtQuick 2.0
+import QtTest 1.0
+import QuickFlux 1.1
+
+TestCase {
+    name : "Store_Batch"
+
+    Dispatcher {
+        id: dispatcher
+        batched: true
+    }
+
+    Store {
+        id: store
+        bindSource: dispatcher
+        batchEnabled: true
+
+        property int total: 0
+        property int totalChangedCount: 0
+        property int batchCount: 0
+        property var childActions: []
+        property var items: []
+        property int itemsChangedCount: 0
+        property int addedCount: 0
+
+        signal added(int value)
+
+        onTotalChanged: totalChangedCount++
+        onItemsChanged: itemsChangedCount++
+        onAdded: addedCount++
+        onBatchDispatched: batchCount++
+
+        Store {
+            id: child
+
+            filterFunctionEnabled: true
+
+            function add(message) {
+                store.childActions.push(message.value);
+            }
+        }
+
+        Filter {
+            type: "add"
+            onDispatched: {
+                store.total += message.value;
+                store.items.push(message.value);
+                store.items = store.items;
+                store.added(message.value);
+            }
+        }
+    }
+
+    function test_batch() {
+        dispatcher.dispatch("add", {value: 1});
+        dispatcher.dispatch("add", {value: 2});
+        dispatcher.dispatch("add", {value: 3});
+
+        compare(store.total, 0);
+
+        tryCompare(store, "batchCount", 1);
+        compare(store.total, 6);
+        compare(store.totalChangedCount, 1);
+        compare(store.childActions, [1, 2, 3]);
+
+        // Changed in place, but still notified once
+        compare(store.items, [1, 2, 3]);
+        compare(store.itemsChangedCount, 1);
+
+        // Other signals are not held
+        compare(store.addedCount, 3);
+    }
+}
@@ -0,0 +1,155 @@
+import QtQuick 2.0
+import QtTest 1.0
+import QuickFlux 1.1
+
+TestCase {
+    name : "Store_Cycle"
+
+    property var received: new Array
+
+    Store {
+        id: storeA
+        redispatchTargets: [storeB]
+
+        Filter {
+            type: "test"
+            onDispatched: received.push("A");
+        }
+    }
+
+    Store {
+        id: storeB
+        redispatchTargets: [storeA, shared]
+
+        Filter {
+            type: "test"
+            onDispatched: received.push("B");
+        }
+    }
+
+    Store {
+        id: shared
+
+        Filter {
+            type: "test"
+            onDispatched: received.push("shared");
+        }
+    }
+
+    Store {
+        id: root
+        redispatchTargets: [shared, shared]
+
+        Store {
+            id: child
+            redispatchTargets: [shared]
+        }
+    }
+
+    // upstream -> cycleB -> cycleA -> cycleD. Only cycleD handles "d".
+    property int handledD: 0
+
+    Store {
+        id: cycleA
+        redispatchTargets: [cycleB, cycleD]
+    }
+
+    Store {
+        id: cycleB
+        redispatchTargets: [cycleA]
+    }
+
+    Store {
+        id: cycleD
+
+        Filter {
+            type: "d"
+            onDispatched: handledD++;
+        }
+    }
+
+    Store {
+        id: upstream
+        redispatchTargets: [cycleB]
+    }
+
+    // pairA and pairB target each other. Neither handles "t" at first.
+    property int handledT: 0
+
+    Store {
+        id: pairA
+        redispatchTargets: [pairB]
+    }
+
+    Store {
+        id: pairB
+        redispatchTargets: [pairA]
+    }
+
+    function test_summaryInvalidatedThroughCycle() {
+        handledT = 0;
+
+        // pairB caches the result. pairA is inside the cycle, so it does not.
+        pairB.dispatch("t");
+        compare(handledT, 0);
+
+        var filter = Qt.createQmlObject('import QuickFlux 1.1; Filter { type: "t"; onDispatched: handledT++ }', pairA);
+
+        pairB.dispatch("t");
+        compare(handledT, 1);
+
+        filter.destroy();
+        wait(0);
+    }
+
+    function test_summaryCycle() {
+        handledD = 0;
+
+        // Resolves the summary of cycleB while cycleA is still being visited
+        cycleA.dispatch("d");
+        compare(handledD, 1);
+
+        // Enter the cycle through cycleB
+        upstream.dispatch("d");
+        compare(handledD, 2);
+
+        cycleB.dispatch("d");
+        compare(handledD, 3);
+    }
+
+    function test_cycle() {
+        received = [];
+        storeA.dispatch("test");
+        compare(received, ["shared", "B", "A"]);
+
+        received = [];
+        storeB.dispatch("test");
+        compare(received, ["A", "shared", "B"]);
+    }
+
+    function test_duplicates() {
+        received = [];
+        root.dispatch("test");
+        compare(received, ["shared"]);
+
+        // A new action is delivered again
+        root.dispatch("test");
+        compare(received, ["shared", "shared"]);
+    }
+
+    function test_changeTargets() {
+        root.redispatchTargets = [];
+
+        received = [];
+        root.dispatch("test");
+        compare(received, ["shared"]); // Through the child
+
+        child.redispatchTargets = [];
+        received = [];
+        root.dispatch("test");
+        compare(received, []);
+
+        child.redispatchTargets = [shared];
+        root.redispatchTargets = [shared, shared];
+    }
+}
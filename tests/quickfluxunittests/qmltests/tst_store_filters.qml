@@ -0,0 +1,73 @@
+import QtQuick 2.0
+import QtTest 1.0
+import QuickFlux 1.1
+
+TestCase {
+    name : "Store_Filters"
+
+    Store {
+        id: store
+        property var received: new Array
+
+        Filter {
+            id: filter1
+            type: "a"
+            onDispatched: store.received.push("filter1:" + type);
+        }
+
+        Filter {
+            id: filter2
+            types: ["a", "b"]
+            onDispatched: store.received.push("filter2:" + type);
+        }
+    }
+
+    SignalSpy {
+        id: typesSpy
+        target: filter1
+        signalName: "typesChanged"
+    }
+
+    function test_route() {
+        store.received = [];
+
+        store.dispatch("a");
+        store.dispatch("b");
+        store.dispatch("c");
+        compare(store.received, ["filter1:a", "filter2:a", "filter2:b"]);
+    }
+
+    function test_typesChanged() {
+        store.received = [];
+        typesSpy.clear();
+
+        filter1.types = ["c"];
+        compare(typesSpy.count, 1);
+        compare(filter1.type, "c");
+
+        // Not changed
+        filter1.types = ["c"];
+        compare(typesSpy.count, 1);
+
+        store.dispatch("a");
+        store.dispatch("c");
+        compare(store.received, ["filter2:a", "filter1:c"]);
+
+        filter1.type = "a";
+    }
+
+    function test_dynamicFilter() {
+        store.received = [];
+
+        var filter = Qt.createQmlObject('import QuickFlux 1.1; Filter { type: "a"; onDispatched: store.received.push("dynamic:" + type); }', store);
+        store.dispatch("a");
+        compare(store.received, ["filter1:a", "filter2:a", "dynamic:a"]);
+
+        filter.destroy();
+        wait(0);
+
+        store.received = [];
+        store.dispatch("a");
+        compare(store.received, ["filter1:a", "filter2:a"]);
+    }
+}
@@ -0,0 +1,103 @@
+import QtQuick 2.0
+import QtTest 1.0
+import QuickFlux 1.1
+
+TestCase {
+    name : "Store_Summary"
+
+    Store {
+        id: rootStore
+
+        Store {
+            id: handlerStore
+
+            Filter {
+                type: "a"
+            }
+        }
+
+        Store {
+            id: idleStore
+
+            function c() {
+            }
+        }
+
+        Store {
+            id: nestedParent
+
+            Store {
+                id: nestedChild
+
+                Filter {
+                    type: "b"
+                }
+            }
+        }
+
+        Store {
+            id: catchAllStore
+            onDispatched: {
+            }
+        }
+    }
+
+    function count(receiver, type) {
+        var report = Profiler.report();
+        for (var i = 0 ; i < report.length; i++) {
+            var entry = report[i];
+            if (entry.category === "Store" && entry.receiver === receiver && entry.type === type) {
+                return entry.count;
+            }
+        }
+        return 0;
+    }
+
+    function init() {
+        Profiler.reset();
+        Profiler.enabled = true;
+    }
+
+    function cleanup() {
+        Profiler.enabled = false;
+        Profiler.reset();
+    }
+
+    function test_skipSubtree() {
+        rootStore.dispatch("a");
+        compare(count("handlerStore", "a"), 1);
+        compare(count("idleStore", "a"), 0);
+        compare(count("nestedParent", "a"), 0);
+        compare(count("nestedChild", "a"), 0);
+        compare(count("catchAllStore", "a"), 1);
+
+        rootStore.dispatch("b");
+        compare(count("handlerStore", "b"), 0);
+        compare(count("nestedParent", "b"), 1);
+        compare(count("nestedChild", "b"), 1);
+        compare(count("catchAllStore", "b"), 1);
+    }
+
+    function test_invalidate() {
+        rootStore.dispatch("a");
+        compare(count("idleStore", "a"), 0);
+
+        var filter = Qt.createQmlObject('import QuickFlux 1.1; Filter { type: "a" }', idleStore);
+        rootStore.dispatch("a");
+        compare(count("idleStore", "a"), 1);
+
+        filter.destroy();
+        wait(0);
+        rootStore.dispatch("a");
+        compare(count("idleStore", "a"), 1);
+
+        // Filter functions
+        rootStore.dispatch("c");
+        compare(count("idleStore", "c"), 0);
+
+        idleStore.filterFunctionEnabled = true;
+        rootStore.dispatch("c");
+        compare(count("idleStore", "c"), 1);
+        idleStore.filterFunctionEnabled = false;
+    }
+}
@@ -17,6 +17,19 @@
 #include "automator.h"
 #include "actiontypes.h"
 #include "qfactioncreator.h"
+#include "priv/qflistener.h"
+#include "priv/qfactiontyperegistry.h"
+#include "priv/qfactiontypepatterns.h"
+#include "priv/qfringbuffer.h"
+#include "allocationcounter.h"
+#include "qfprofiler.h"
+#include "qfnativemiddleware.h"
+#include "qfmiddlewarelist.h"
+
+// The benchmarks are slow. They run only if QUICKFLUX_BENCHMARK is set.
+#define SKIP_UNLESS_BENCHMARK() \
+    if (qEnvironmentVariableIsEmpty("QUICKFLUX_BENCHMARK")) \
+        QSKIP("Set QUICKFLUX_BENCHMARK=1 to run the benchmarks")
 
 QuickFluxUnitTests::QuickFluxUnitTests()
 {
@@ -74,6 +87,33 @@ void QuickFluxUnitTests::singletonObject()
     QVERIFY(dummyAction->property("value").toInt() == 13);
 }
 
+void QuickFluxUnitTests::singletonObject_cache()
+{
+    QFAppDispatcher* dispatcher = nullptr;
+
+    {
+        QQmlApplicationEngine engine;
+        engine.addImportPath("qrc:/");
+
+        dispatcher = QFAppDispatcher::instance(&engine);
+        QVERIFY(dispatcher);
+        QCOMPARE(QFAppDispatcher::instance(&engine), dispatcher);
+        QCOMPARE(QFAppDispatcher::singletonObject(&engine, "QuickFlux", 1, 0, "AppDispatcher"), dispatcher);
+
+        QObject* dummyAction = QFAppDispatcher::singletonObject(&engine,"QuickFluxTests",1,0,"DummyAction");
+        QVERIFY(dummyAction);
+        QCOMPARE(QFAppDispatcher::singletonObject(&engine,"QuickFluxTests",1,0,"DummyAction"), dummyAction);
+    }
+
+    // The cache is invalidated once the engine is destroyed
+    QQmlApplicationEngine engine;
+    engine.addImportPath("qrc:/");
+
+    QFAppDispatcher* another = QFAppDispatcher::instance(&engine);
+    QVERIFY(another);
+    QCOMPARE(another->engine(), &engine);
+}
+
 void QuickFluxUnitTests::signalProxy()
 {
 
@@ -329,6 +369,991 @@ void QuickFluxUnitTests::dispatcherHook()
 
 }
 
+void QuickFluxUnitTests::actionTypeRegistry()
+{
+    QCOMPARE(QFActionTypeRegistry::lookup("actionTypeRegistry.unknown"), 0);
+
+    int id1 = QFActionTypeRegistry::intern("actionTypeRegistry.type1");
+    int id2 = QFActionTypeRegistry::intern("actionTypeRegistry.type2");
+
+    QVERIFY(id1 > 0);
+    QVERIFY(id2 > 0);
+    QVERIFY(id1 != id2);
+
+    // A different QString instance with the same content shares the id
+    QString type1 = QString("actionTypeRegistry.") + QString("type1");
+    QCOMPARE(QFActionTypeRegistry::lookup(type1), id1);
+    QCOMPARE(QFActionTypeRegistry::intern(type1), id1);
+    QCOMPARE(QFActionTypeRegistry::lookup("actionTypeRegistry.type2"), id2);
+
+    QCOMPARE(QFActionTypeRegistry::name(id1), QString("actionTypeRegistry.type1"));
+    QCOMPARE(QFActionTypeRegistry::name(0), QString());
+    QVERIFY(QFActionTypeRegistry::count() >= id2);
+
+    QVector<int> ids = QFActionTypeRegistry::intern(QStringList() << "actionTypeRegistry.type2" << "actionTypeRegistry.type1" << "actionTypeRegistry.type2");
+    QCOMPARE(ids, QVector<int>() << id2 << id1);
+}
+
+void QuickFluxUnitTests::appScriptSignalConditionTypes()
+{
+    QQmlApplicationEngine engine;
+    QQmlComponent component(&engine);
+    component.setData("import QtQuick 2.0\n"
+                      "import QuickFlux 1.1\n"
+                      "Item {\n"
+                      "  id: root\n"
+                      "  signal triggered(int value)\n"
+                      "  property int total: 0\n"
+                      "  property var script: AppScript {\n"
+                      "    script: {\n"
+                      "      for (var i = 0 ; i < 10 ; i++) {\n"
+                      "        once(root.triggered, function(value) { root.total += value; });\n"
+                      "      }\n"
+                      "    }\n"
+                      "  }\n"
+                      "}\n", QUrl());
+
+    QScopedPointer<QObject> root(component.create());
+    QVERIFY(root);
+
+    QObject *script = root->property("script").value<QObject*>();
+    QVERIFY(script);
+
+    QMetaObject::invokeMethod(script, "run");
+
+    // Every signal condition waits for a type of its own
+    QFListener *listener = script->findChild<QFListener*>();
+    QVERIFY(listener);
+    QCOMPARE(listener->types().size(), 10);
+
+    QMetaObject::invokeMethod(root.data(), "triggered", Q_ARG(int, 2));
+    QCOMPARE(root->property("total").toInt(), 20);
+    QCOMPARE(listener->types().size(), 0);
+
+    // The types of the released conditions are reused, so the registry does not grow
+    const int count = QFActionTypeRegistry::count();
+
+    for (int i = 0 ; i < 5 ; i++) {
+        QMetaObject::invokeMethod(script, "run");
+        QMetaObject::invokeMethod(root.data(), "triggered", Q_ARG(int, 1));
+    }
+
+    QCOMPARE(QFActionTypeRegistry::count(), count);
+    QCOMPARE(root->property("total").toInt(), 70);
+}
+
+void QuickFluxUnitTests::actionTypePatterns()
+{
+    QVERIFY(QFActionTypePatterns::isPattern("patterns/*"));
+    QVERIFY(QFActionTypePatterns::isPattern("patterns/lo?d"));
+    QVERIFY(!QFActionTypePatterns::isPattern("patterns/load"));
+
+    int prefix = QFActionTypePatterns::compile("patterns/*");
+    int single = QFActionTypePatterns::compile("patterns/lo?d");
+    int infix = QFActionTypePatterns::compile("patterns/*ed");
+    int stars = QFActionTypePatterns::compile("patterns/**ed");
+
+    QVERIFY(prefix > 0);
+    QCOMPARE(QFActionTypePatterns::compile(QString("patterns/") + "*"), prefix);
+
+    auto match = [](const QString &type) {
+        return QFActionTypePatterns::match(QFActionTypeRegistry::intern(type));
+    };
+
+    QCOMPARE(match("patterns/load"), QVector<int>() << prefix << single);
+    QCOMPARE(match("patterns/loaded"), QVector<int>() << prefix << infix << stars);
+    QCOMPARE(match("patterns/"), QVector<int>() << prefix);
+    QCOMPARE(match("patterns"), QVector<int>());
+    QCOMPARE(match("other/loaded"), QVector<int>());
+
+    // The cache is refreshed by a new pattern
+    int any = QFActionTypePatterns::compile("*");
+    QCOMPARE(match("other/loaded"), QVector<int>() << any);
+
+    QVector<int> typeIds;
+    QVector<int> patternIds;
+    QFActionTypePatterns::compile(QStringList() << "patterns/load" << "patterns/*" << "patterns/*", typeIds, patternIds);
+    QCOMPARE(typeIds, QVector<int>() << QFActionTypeRegistry::intern("patterns/load"));
+    QCOMPARE(patternIds, QVector<int>() << prefix);
+
+    // Escaped wildcards are literal characters
+    QVERIFY(!QFActionTypePatterns::isPattern("patterns/rate\\*"));
+    QVERIFY(QFActionTypePatterns::isPattern("patterns/rate\\\\*"));
+    QCOMPARE(QFActionTypePatterns::unescape("patterns/rate\\*"), QString("patterns/rate*"));
+
+    QFActionTypePatterns::compile(QStringList() << "patterns/rate\\*", typeIds, patternIds);
+    QCOMPARE(typeIds, QVector<int>() << QFActionTypeRegistry::intern("patterns/rate*"));
+    QVERIFY(patternIds.isEmpty());
+
+    int literal = QFActionTypePatterns::compile("patterns/\\?*");
+    QVERIFY(match("patterns/?load").contains(literal));
+    QVERIFY(!match("patterns/xload").contains(literal));
+
+    // Listeners with patterns keep the order of registration
+    QQmlEngine engine;
+    QFDispatcher dispatcher;
+    dispatcher.setEngine(&engine);
+
+    QStringList received;
+
+    auto addListener = [&](const QString &name, const QStringList &types) {
+        auto listener = new QFListener(&dispatcher);
+        listener->setTypes(types);
+        connect(listener, &QFListener::dispatched, [&received, name](const QString &type) {
+            received << name + ":" + type;
+        });
+        dispatcher.addListener(listener);
+        return listener;
+    };
+
+    addListener("exact", QStringList() << "patterns/load");
+    auto prefixListener = addListener("prefix", QStringList() << "patterns/*");
+    addListener("both", QStringList() << "patterns/load" << "patterns/lo*");
+
+    dispatcher.dispatch("patterns/load", QVariant());
+    dispatcher.dispatch("patterns/save", QVariant());
+    dispatcher.dispatch("unmatched", QVariant());
+
+    QCOMPARE(received, QStringList() << "exact:patterns/load" << "prefix:patterns/load" << "both:patterns/load"
+                                     << "prefix:patterns/save");
+
+    received.clear();
+    prefixListener->setTypes(QStringList() << "unmatched");
+    dispatcher.dispatch("patterns/save", QVariant());
+    dispatcher.dispatch("unmatched", QVariant());
+    QCOMPARE(received, QStringList() << "prefix:unmatched");
+}
+
+void QuickFluxUnitTests::coalescing()
+{
+    QQmlEngine engine;
+    QFDispatcher dispatcher;
+    dispatcher.setEngine(&engine);
+
+    dispatcher.setCoalescing("scroll");
+    dispatcher.setCoalescing("sensor", "id");
+
+    auto sensor = [](const QString &id, int value) {
+        QVariantMap message;
+        message["id"] = id;
+        message["value"] = value;
+        return message;
+    };
+
+    QStringList received;
+
+    QFSubscription start = dispatcher.subscribe("start", [&](const QVariant &message) {
+        Q_UNUSED(message);
+
+        // Reentrant dispatches are queued
+        dispatcher.dispatch("scroll", QVariant(1));
+        dispatcher.dispatch("sensor", sensor("a", 1));
+        dispatcher.dispatch("scroll", QVariant(2));
+        dispatcher.dispatch("sensor", sensor("b", 1));
+        dispatcher.dispatch("other", QVariant(1));
+        dispatcher.dispatch("sensor", sensor("a", 2));
+        dispatcher.dispatch("scroll", QVariant(3));
+    });
+
+    QFSubscription scroll = dispatcher.subscribe("scroll", [&](const QVariant &message) {
+        received << QString("scroll:%1").arg(message.toInt());
+    });
+
+    QFSubscription sensors = dispatcher.subscribe("sensor", [&](const QVariant &message) {
+        auto map = message.toMap();
+        received << QString("sensor:%1:%2").arg(map["id"].toString()).arg(map["value"].toInt());
+    });
+
+    QFSubscription other = dispatcher.subscribe("other", [&](const QVariant &message) {
+        Q_UNUSED(message);
+        received << "other";
+    });
+
+    dispatcher.dispatch("start", QVariant());
+
+    QCOMPARE(received, QStringList() << "sensor:b:1" << "other" << "sensor:a:2" << "scroll:3");
+    QCOMPARE(dispatcher.squashedCount("scroll"), 2);
+    QCOMPARE(dispatcher.squashedCount("sensor"), 1);
+    QCOMPARE(dispatcher.squashedCount(), 3);
+
+    // Without the policy, every action is delivered
+    received.clear();
+    dispatcher.removeCoalescing("scroll");
+    dispatcher.dispatch("start", QVariant());
+
+    QCOMPARE(received, QStringList() << "scroll:1" << "scroll:2" << "sensor:b:1" << "other" << "sensor:a:2" << "scroll:3");
+    QCOMPARE(dispatcher.squashedCount(), 4);
+}
+
+void QuickFluxUnitTests::batchedDispatch()
+{
+    QQmlEngine engine;
+    QFDispatcher dispatcher;
+    dispatcher.setEngine(&engine);
+    dispatcher.setBatched(true);
+
+    QStringList received;
+    connect(&dispatcher, &QFDispatcher::dispatched, [&](QString type, QJSValue message) {
+        Q_UNUSED(message);
+        received << type;
+
+        // Dispatched by a listener during the batch. It joins the same batch.
+        if (type == "b")
+            dispatcher.dispatch("d", QVariant());
+    });
+
+    QList<QStringList> batches;
+    connect(&dispatcher, &QFDispatcher::batchDispatched, [&](QJSValue actions) {
+        QStringList types;
+        for (int i = 0 ; i < actions.property("length").toInt(); i++)
+            types << actions.property(quint32(i)).property("type").toString();
+        batches << types;
+    });
+
+    dispatcher.dispatch("a", QVariant(1));
+    dispatcher.dispatch("b", QVariant(2));
+    dispatcher.dispatch("c", QVariant(3));
+    QCOMPARE(received, QStringList());
+
+    // Flushed by a zero-interval timer without a window
+    QTRY_COMPARE(received, QStringList() << "a" << "b" << "c" << "d");
+    QCOMPARE(batches.size(), 1);
+    QCOMPARE(batches.first(), QStringList() << "a" << "b" << "c" << "d");
+
+    dispatcher.dispatch("e", QVariant());
+    dispatcher.flush();
+    QCOMPARE(received.last(), QString("e"));
+    QCOMPARE(batches.size(), 2);
+
+    // Leaving batched mode delivers the pending actions
+    dispatcher.dispatch("f", QVariant());
+    dispatcher.setBatched(false);
+    QCOMPARE(received.last(), QString("f"));
+
+    dispatcher.dispatch("g", QVariant());
+    QCOMPARE(received.last(), QString("g"));
+    QCOMPARE(batches.size(), 3);
+}
+
+void QuickFluxUnitTests::priorityLanes()
+{
+    QQmlEngine engine;
+    QFDispatcher dispatcher;
+    dispatcher.setEngine(&engine);
+
+    dispatcher.setLane("click", QFDispatcher::InputLane);
+    dispatcher.setLane("telemetry", QFDispatcher::BackgroundLane);
+    QCOMPARE(dispatcher.lane("click"), int(QFDispatcher::InputLane));
+    QCOMPARE(dispatcher.lane("unknown"), int(QFDispatcher::NormalLane));
+
+    QStringList received;
+    QStringList burst;
+
+    connect(&dispatcher, &QFDispatcher::dispatched, [&](QString type, QJSValue message) {
+        if (type == "start") {
+            for (auto action : burst)
+                dispatcher.dispatch(action.split(":").first(), QVariant(action));
+            return;
+        }
+        received << message.toString();
+    });
+
+    burst << "telemetry:1" << "telemetry:2" << "normal:1" << "click:1";
+    dispatcher.dispatch("start", QVariant());
+    QCOMPARE(received, QStringList() << "click:1" << "normal:1" << "telemetry:1" << "telemetry:2");
+
+    auto metrics = dispatcher.laneMetrics();
+    QCOMPARE(metrics.size(), 3);
+    QCOMPARE(metrics[2].toMap()["lane"].toString(), QString("background"));
+    QCOMPARE(metrics[2].toMap()["delivered"].toInt(), 2);
+    QCOMPARE(metrics[2].toMap()["maxDepth"].toInt(), 2);
+    QCOMPARE(metrics[2].toMap()["depth"].toInt(), 0);
+    QVERIFY(metrics[2].toMap()["maxWait"].toDouble() >= metrics[0].toMap()["maxWait"].toDouble());
+
+    // The background lane is served after two actions of the higher lanes
+    dispatcher.setStarvationLimit(2);
+    dispatcher.resetLaneMetrics();
+    received.clear();
+    burst.clear();
+    burst << "telemetry:1" << "normal:1" << "normal:2" << "normal:3" << "normal:4";
+    dispatcher.dispatch("start", QVariant());
+    QCOMPARE(received, QStringList() << "normal:1" << "normal:2" << "telemetry:1" << "normal:3" << "normal:4");
+    QCOMPARE(dispatcher.laneMetrics()[1].toMap()["delivered"].toInt(), 4);
+}
+
+void QuickFluxUnitTests::ringBuffer()
+{
+    {
+        // Wrap around and grow
+        QFRingBuffer<int> buffer;
+
+        for (int i = 0 ; i < 10; i++)
+            buffer.enqueue(int(i));
+
+        for (int i = 0 ; i < 5; i++)
+            QCOMPARE(buffer.dequeue(), i);
+
+        for (int i = 10 ; i < 40; i++)
+            buffer.enqueue(int(i));
+
+        QCOMPARE(buffer.size(), 35);
+        QCOMPARE(buffer.capacity(), 64);
+        QCOMPARE(buffer[0], 5);
+        QCOMPARE(buffer.last(), 39);
+
+        for (int i = 5 ; i < 40; i++)
+            QCOMPARE(buffer.dequeue(), i);
+
+        QVERIFY(buffer.isEmpty());
+    }
+
+    {
+        // Move-only values
+        QFRingBuffer<std::unique_ptr<int>> buffer;
+        buffer.enqueue(std::unique_ptr<int>(new int(1)));
+        buffer.enqueue(std::unique_ptr<int>(new int(2)));
+
+        QCOMPARE(*buffer.dequeue(), 1);
+        QCOMPARE(*buffer.dequeue(), 2);
+    }
+
+    {
+        // A buffer reused in the steady state does not allocate
+        const int depth = 32;
+        const int round = 1000;
+
+        QFRingBuffer<QFActionEnvelope> buffer;
+        QVector<QFActionEnvelope> actions;
+
+        for (int i = 0 ; i < depth; i++)
+            actions << QFActionEnvelope("action" + QString::number(i), QVariant(i));
+
+        // Warm up
+        for (int i = 0 ; i < depth; i++)
+            buffer.enqueue(std::move(actions[i]));
+
+        for (int i = 0 ; i < depth; i++)
+            actions[i] = buffer.dequeue();
+
+        const int capacity = buffer.capacity();
+        const quint64 before = AllocationCounter::count();
+
+        for (int r = 0 ; r < round; r++)
+        {
+            for (int i = 0 ; i < depth; i++)
+                buffer.enqueue(std::move(actions[i]));
+
+            for (int i = 0 ; i < depth; i++)
+                actions[i] = buffer.dequeue();
+        }
+
+        QCOMPARE(AllocationCounter::count() - before, quint64(0));
+        QCOMPARE(buffer.capacity(), capacity);
+        QCOMPARE(actions[depth - 1].type(), QString("action%1").arg(depth - 1));
+    }
+}
+
+void QuickFluxUnitTests::listenerSlotReuse()
+{
+    QQmlEngine engine;
+    QFDispatcher dispatcher;
+    dispatcher.setEngine(&engine);
+
+    QStringList order;
+
+    auto create = [&](const QString &name) {
+        QFListener* listener = new QFListener(&dispatcher);
+        connect(listener, &QFListener::dispatched, [&order, name]() {
+            order << name;
+        });
+        return listener;
+    };
+
+    int id1 = dispatcher.addListener(create("listener1"));
+    int id2 = dispatcher.addListener(create("listener2"));
+    QVERIFY(id1 > 0);
+    QVERIFY(id2 > 0);
+
+    QFListener* listener3 = create("listener3");
+    int id3 = dispatcher.addListener(listener3);
+
+    // Destroying a listener releases its slot.
+    delete listener3;
+    dispatcher.removeListener(id1);
+
+    int id4 = dispatcher.addListener(create("listener4"));
+    int id5 = dispatcher.addListener(create("listener5"));
+    QVERIFY(id4 > 0);
+    QVERIFY(id5 > 0);
+    QVERIFY(id4 != id1 && id4 != id3);
+    QVERIFY(id5 != id1 && id5 != id3);
+
+    // A stale id never removes the listener reusing its slot.
+    dispatcher.removeListener(id1);
+    dispatcher.removeListener(id3);
+
+    dispatcher.dispatch("test", QJSValue());
+
+    // Reused slots still follow the registration order.
+    QCOMPARE(order, QStringList() << "listener2" << "listener4" << "listener5");
+}
+
+static int s_cyclicWarningCount = 0;
+
+static void countCyclicWarning(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
+    Q_UNUSED(type);
+    Q_UNUSED(context);
+
+    if (msg.contains("Cyclic dependency detected")) {
+        s_cyclicWarningCount++;
+    }
+}
+
+void QuickFluxUnitTests::waitForSchedule()
+{
+    QQmlEngine engine;
+    QFDispatcher dispatcher;
+    dispatcher.setEngine(&engine);
+
+    QStringList order;
+
+    auto create = [&](const QString &name) {
+        QFListener* listener = new QFListener(&dispatcher);
+        connect(listener, &QFListener::dispatched, [&order, name]() {
+            order << name;
+        });
+        dispatcher.addListener(listener);
+        return listener;
+    };
+
+    QFListener* listener1 = create("listener1");
+    QFListener* listener2 = create("listener2");
+    QFListener* listener3 = create("listener3");
+    QFListener* anchor = create("anchor");
+    anchor->setTypes(QStringList());
+
+    // listener3 -> anchor -> listener1 -> listener2
+    listener1->setWaitFor(QVector<int>() << listener2->listenerId());
+    anchor->setWaitFor(QVector<int>() << listener1->listenerId());
+    listener3->setWaitFor(QVector<int>() << anchor->listenerId());
+
+    dispatcher.dispatch("test", QJSValue());
+    QCOMPARE(order, QStringList() << "listener2" << "listener1" << "listener3");
+
+    // The schedule is compiled again after a change.
+    listener1->setWaitFor(QVector<int>());
+    order.clear();
+    dispatcher.dispatch("test", QJSValue());
+    QCOMPARE(order, QStringList() << "listener1" << "listener2" << "listener3");
+
+    s_cyclicWarningCount = 0;
+    QtMessageHandler previous = qInstallMessageHandler(countCyclicWarning);
+
+    // A cycle is reported by the change that makes it, not on dispatch.
+    listener2->setWaitFor(QVector<int>() << listener3->listenerId());
+    QCOMPARE(s_cyclicWarningCount, 0);
+
+    listener1->setWaitFor(QVector<int>() << listener2->listenerId());
+    QCOMPARE(s_cyclicWarningCount, 1);
+
+    for (int i = 0 ; i < 3 ; i++) {
+        order.clear();
+        dispatcher.dispatch("test", QJSValue());
+    }
+
+    QCOMPARE(s_cyclicWarningCount, 1);
+    QCOMPARE(order.size(), 3);
+
+    qInstallMessageHandler(previous);
+}
+
+void QuickFluxUnitTests::subscribe()
+{
+    QFDispatcher dispatcher;
+    QVariantList received;
+
+    {
+        QFSubscription subscription = dispatcher.subscribe("subscribe.type1", [&](const QVariant &message) {
+            received << message;
+        });
+        QVERIFY(subscription.isActive());
+
+        // No engine is needed if nobody in QML receives the action.
+        dispatcher.dispatch("subscribe.type1", QVariant(1));
+        dispatcher.dispatch("subscribe.type2", QVariant(2));
+        QCOMPARE(received, QVariantList() << 1);
+
+        QFSubscription moved = std::move(subscription);
+        QVERIFY(!subscription.isActive());
+        QVERIFY(moved.isActive());
+
+        dispatcher.dispatch("subscribe.type1", QVariant(3));
+        QCOMPARE(received, QVariantList() << 1 << 3);
+    }
+
+    // Destroying the handle removes the callback.
+    dispatcher.dispatch("subscribe.type1", QVariant(4));
+    QCOMPARE(received, QVariantList() << 1 << 3);
+
+    // Share the action with a listener in the script side.
+    QQmlEngine engine;
+    dispatcher.setEngine(&engine);
+
+    QFListener* listener = new QFListener(&dispatcher);
+    dispatcher.addListener(listener);
+    QVariant listenerMessage;
+    connect(listener, &QFListener::dispatched, [&](QString type, QJSValue message) {
+        Q_UNUSED(type);
+        listenerMessage = message.toVariant();
+    });
+
+    QFSubscription subscription = dispatcher.subscribe("subscribe.type1", [&](const QVariant &message) {
+        received << message;
+    });
+
+    QVariantMap map;
+    map["value"] = 5;
+    dispatcher.dispatch("subscribe.type1", map);
+    QCOMPARE(listenerMessage.toMap()["value"].toInt(), 5);
+    QCOMPARE(received.size(), 3);
+    QCOMPARE(received.last().toMap()["value"].toInt(), 5);
+
+    // An action from QML is converted for the native callback.
+    dispatcher.dispatch("subscribe.type1", engine.toScriptValue<QVariant>(6));
+    QCOMPARE(received.size(), 4);
+    QCOMPARE(received.last().toInt(), 6);
+
+    subscription.unsubscribe();
+    QVERIFY(!subscription.isActive());
+    dispatcher.dispatch("subscribe.type1", QVariant(7));
+    QCOMPARE(received.size(), 4);
+}
+
+void QuickFluxUnitTests::nativeMiddleware()
+{
+    class Recorder : public QFNativeMiddleware {
+    public:
+        void process(const QString &type, QFActionEnvelope &envelope, const Next &next) override {
+            types << type;
+            materialized << envelope.isMaterialized();
+
+            if (type == "drop")
+                return;
+
+            next(envelope);
+        }
+
+        QStringList types;
+        QList<bool> materialized;
+    };
+
+    auto create = [](QQmlEngine &engine, const QString &middlewares) {
+        QString qml = QString("import QtQuick 2.0\n"
+                              "import QuickFlux 1.1\n"
+                              "Item {\n"
+                              "  property alias dispatcher: dispatcher\n"
+                              "  property alias middlewares: middlewares\n"
+                              "  Dispatcher { id: dispatcher }\n"
+                              "  MiddlewareList {\n"
+                              "  id: middlewares\n"
+                              "  applyTarget: dispatcher\n"
+                              "%1"
+                              "  }\n"
+                              "}\n").arg(middlewares);
+
+        QQmlComponent comp(&engine);
+        comp.setData(qml.toUtf8(), QUrl());
+        return comp.create();
+    };
+
+    {
+        // Only native middlewares. The message is never converted.
+        QQmlEngine engine;
+        QScopedPointer<QObject> root(create(engine, ""));
+        QVERIFY(root.data());
+
+        auto dispatcher = qobject_cast<QFDispatcher*>(root->property("dispatcher").value<QObject*>());
+        QVERIFY(dispatcher);
+
+        Recorder recorder;
+        QQmlListReference data(root->property("middlewares").value<QObject*>(), "data");
+        data.append(&recorder);
+
+        QStringList received;
+        QVariantList messages;
+        QFSubscription subscription1 = dispatcher->subscribe("pass", [&](const QVariant &message) {
+            received << "pass";
+            messages << message;
+        });
+        QFSubscription subscription2 = dispatcher->subscribe("drop", [&](const QVariant &message) {
+            Q_UNUSED(message);
+            received << "drop";
+        });
+
+        dispatcher->dispatch("pass", QVariant(7));
+        dispatcher->dispatch("drop", QVariant(8));
+
+        QCOMPARE(recorder.types, QStringList() << "pass" << "drop");
+        QCOMPARE(recorder.materialized, QList<bool>() << false << false);
+        QCOMPARE(received, QStringList() << "pass");
+        QCOMPARE(messages, QVariantList() << QVariant(7));
+    }
+
+    {
+        // Mixed with a QML middleware, which runs first as it is declared first
+        QQmlEngine engine;
+        QScopedPointer<QObject> root(create(engine,
+            "  Middleware { function dispatch(type, message) { next(type === 'rename' ? 'drop' : type, message); } }\n"));
+        QVERIFY(root.data());
+
+        auto dispatcher = qobject_cast<QFDispatcher*>(root->property("dispatcher").value<QObject*>());
+        QVERIFY(dispatcher);
+
+        Recorder recorder;
+        QQmlListReference data(root->property("middlewares").value<QObject*>(), "data");
+        data.append(&recorder);
+
+        int count = 0;
+        QFSubscription subscription = dispatcher->subscribe("pass", [&](const QVariant &message) {
+            QCOMPARE(message, QVariant(1));
+            count++;
+        });
+
+        dispatcher->dispatch("rename", QVariant(0));
+        dispatcher->dispatch("pass", QVariant(1));
+
+        QCOMPARE(recorder.types, QStringList() << "drop" << "pass");
+        QCOMPARE(count, 1);
+    }
+}
+
+void QuickFluxUnitTests::nativeMiddleware_async()
+{
+    class Loader : public QFNativeMiddleware {
+    public:
+        void process(const QString &type, QFActionEnvelope &envelope, const Next &next) override {
+            if (type != "slow") {
+                next(envelope);
+                return;
+            }
+
+            runAsync(next, [type](const Next &next) {
+                QThread::msleep(50);
+                next(type, QVariant(QString("loaded")));
+            });
+        }
+    };
+
+    QString qml = QString("import QtQuick 2.0\n"
+                          "import QuickFlux 1.1\n"
+                          "Item {\n"
+                          "  property alias dispatcher: dispatcher\n"
+                          "  property alias middlewares: middlewares\n"
+                          "  Dispatcher { id: dispatcher }\n"
+                          "  MiddlewareList {\n"
+                          "  id: middlewares\n"
+                          "  applyTarget: dispatcher\n"
+                          "  }\n"
+                          "}\n");
+
+    QQmlEngine engine;
+    QQmlComponent comp(&engine);
+    comp.setData(qml.toUtf8(), QUrl());
+    QScopedPointer<QObject> root(comp.create());
+    QVERIFY(root.data());
+
+    auto dispatcher = qobject_cast<QFDispatcher*>(root->property("dispatcher").value<QObject*>());
+    QVERIFY(dispatcher);
+
+    auto middlewares = qobject_cast<QFMiddlewareList*>(root->property("middlewares").value<QObject*>());
+    QVERIFY(middlewares);
+
+    Loader loader;
+    QQmlListReference data(middlewares, "data");
+    data.append(&loader);
+
+    QStringList received;
+    QFSubscription subscription1 = dispatcher->subscribe("slow", [&](const QVariant &message) {
+        QCOMPARE(message.toString(), QString("loaded"));
+        received << "slow";
+    });
+    QFSubscription subscription2 = dispatcher->subscribe("fast", [&](const QVariant &message) {
+        Q_UNUSED(message);
+        received << "fast";
+    });
+
+    // The later action waits for the one in flight
+    QCOMPARE(middlewares->ordering(), QFMiddlewareList::StrictFifo);
+
+    dispatcher->dispatch("slow");
+    dispatcher->dispatch("fast");
+    QCOMPARE(received, QStringList());
+
+    QTRY_COMPARE(received, QStringList() << "slow" << "fast");
+
+    // Only the same type is ordered
+    received.clear();
+    middlewares->setOrdering(QFMiddlewareList::PerTypeFifo);
+
+    dispatcher->dispatch("slow");
+    dispatcher->dispatch("fast");
+    dispatcher->dispatch("slow");
+    QCOMPARE(received, QStringList() << "fast");
+
+    QTRY_COMPARE(received, QStringList() << "fast" << "slow" << "slow");
+
+    // The chain is rebuilt while an action is held. It continues after the same middleware.
+    class Holder : public QFNativeMiddleware {
+    public:
+        void process(const QString &type, QFActionEnvelope &envelope, const Next &next) override {
+            if (type == "held") {
+                held = next;
+                holding = true;
+                return;
+            }
+            next(envelope);
+        }
+
+        Next held;
+        bool holding = false;
+    };
+
+    class Recorder : public QFNativeMiddleware {
+    public:
+        void process(const QString &type, QFActionEnvelope &envelope, const Next &next) override {
+            types << type;
+            next(envelope);
+        }
+
+        QStringList types;
+    };
+
+    Recorder *first = new Recorder();
+    Holder holder;
+    Recorder last;
+
+    data.append(first);
+    data.append(&holder);
+    data.append(&last);
+
+    QFSubscription subscription3 = dispatcher->subscribe("held", [&](const QVariant &message) {
+        Q_UNUSED(message);
+        received << "held";
+    });
+
+    received.clear();
+    dispatcher->dispatch("held");
+    QVERIFY(holder.holding);
+
+    // The holder moves one position forward. The chain is rebuilt by the next action.
+    delete first;
+    dispatcher->dispatch("fast");
+
+    holder.held(QString("held"));
+    holder.held = QFNativeMiddleware::Next();
+
+    QTRY_COMPARE(received, QStringList() << "held" << "fast");
+    // "fast" passed the chain first, and waited for "held" to be delivered
+    QCOMPARE(last.types, QStringList() << "fast" << "held");
+}
+
+void QuickFluxUnitTests::profiler()
+{
+    QQmlEngine engine;
+    QFDispatcher dispatcher;
+    dispatcher.setEngine(&engine);
+
+    QObject owner;
+    owner.setObjectName("profiledListener");
+
+    QFListener* listener = new QFListener(&owner);
+    dispatcher.addListener(listener);
+
+    QFProfiler* profiler = QFProfiler::instance();
+    profiler->reset();
+
+    auto countOf = [&]() {
+        foreach (QVariant item, profiler->report()) {
+            QVariantMap entry = item.toMap();
+            if (entry["category"] == "Listener" && entry["receiver"] == "profiledListener" && entry["type"] == "profiler.cpp") {
+                return entry["count"].toInt();
+            }
+        }
+        return 0;
+    };
+
+    dispatcher.dispatch("profiler.cpp", QVariant(1));
+    QCOMPARE(countOf(), 0);
+
+    profiler->setEnabled(true);
+    QVERIFY(QFProfiler::isEnabled());
+    dispatcher.dispatch("profiler.cpp", QVariant(2));
+    dispatcher.dispatch("profiler.cpp", QVariant(3));
+    profiler->setEnabled(false);
+
+    dispatcher.dispatch("profiler.cpp", QVariant(4));
+    QCOMPARE(countOf(), 2);
+
+    profiler->reset();
+    QCOMPARE(countOf(), 0);
+}
+
+void QuickFluxUnitTests::profiler_trace()
+{
+    QQmlEngine engine;
+    QFDispatcher dispatcher;
+    dispatcher.setEngine(&engine);
+
+    QObject owner;
+    owner.setObjectName("tracedListener");
+
+    QFListener* listener = new QFListener(&owner);
+    dispatcher.addListener(listener);
+
+    // A reentrant dispatch is queued behind the current action
+    connect(listener, &QFListener::dispatched, [&](QString type) {
+        if (type == "trace.first") {
+            dispatcher.dispatch("trace.second", QVariant());
+        }
+    });
+
+    QFProfiler* profiler = QFProfiler::instance();
+    profiler->clearTrace();
+    profiler->setTracing(true);
+    dispatcher.dispatch("trace.first", QVariant());
+    profiler->setTracing(false);
+
+    QTemporaryDir dir;
+    QString fileName = dir.path() + "/trace.json";
+    QVERIFY(profiler->saveTrace(fileName));
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QJsonArray events = QJsonDocument::fromJson(file.readAll()).object()["traceEvents"].toArray();
+
+    QStringList spans;
+    foreach (QJsonValue value, events) {
+        QJsonObject event = value.toObject();
+        if (event["ph"] == "X" || event["ph"] == "i") {
+            spans << QString("%1 %2 %3").arg(event["ph"].toString(), event["cat"].toString(), event["args"].toObject()["type"].toString());
+        }
+    }
+
+    QVERIFY(spans.contains("i Queue trace.second"));
+    QVERIFY(spans.contains("X Queue trace.second"));
+    QVERIFY(spans.contains("X Listener trace.first"));
+    QVERIFY(spans.contains("X Listener trace.second"));
+    QVERIFY(spans.contains("X Dispatcher trace.first"));
+
+    profiler->clearTrace();
+}
+
+void QuickFluxUnitTests::dispatch_allocations()
+{
+    const int round = 1000;
+
+    // Allocations per dispatch in the steady state
+    auto measure = [](int listenerCount) {
+        QQmlEngine engine;
+        QFDispatcher dispatcher;
+        dispatcher.setEngine(&engine);
+
+        int count = 0;
+
+        for (int i = 0 ; i < listenerCount ; i++) {
+            QFListener* listener = new QFListener(&dispatcher);
+            if (i % 2 == 0) {
+                listener->setTypes(QStringList() << "target");
+            }
+            QObject::connect(listener, &QFListener::dispatched, [&count]() {
+                count++;
+            });
+            dispatcher.addListener(listener);
+        }
+
+        QString type("target");
+        QJSValue message;
+
+        // Warm up
+        dispatcher.dispatch(type, message);
+
+        quint64 before = AllocationCounter::count();
+        for (int i = 0 ; i < round ; i++) {
+            dispatcher.dispatch(type, message);
+        }
+        quint64 allocations = AllocationCounter::count() - before;
+
+        return qMakePair(allocations / round, count);
+    };
+
+    const auto few = measure(10);
+    const auto many = measure(100);
+
+    QCOMPARE(few.second, 10 * (round + 1));
+    QCOMPARE(many.second, 100 * (round + 1));
+
+    // Only the envelope and its message may allocate. Nothing is allocated per listener.
+    QCOMPARE(many.first, few.first);
+}
+
+void QuickFluxUnitTests::dispatchFromAnyThread()
+{
+    QQmlEngine engine;
+    QFDispatcher dispatcher;
+    dispatcher.setEngine(&engine);
+
+    const int producerCount = 8;
+    const int actionCount = 20000;
+    const int total = producerCount * actionCount;
+
+    QVector<int> lastSeq(producerCount, -1);
+    int count = 0;
+    bool inOrder = true;
+    bool inMainThread = true;
+
+    connect(&dispatcher, &QFDispatcher::dispatched, [&](QString type, QJSValue message) {
+        Q_UNUSED(type);
+
+        if (QThread::currentThread() != qApp->thread()) {
+            inMainThread = false;
+        }
+
+        int producer = message.property("producer").toInt();
+        int seq = message.property("seq").toInt();
+
+        if (seq != lastSeq[producer] + 1) {
+            inOrder = false;
+        }
+        lastSeq[producer] = seq;
+        count++;
+    });
+
+    QList<QThread*> threads;
+
+    for (int i = 0 ; i < producerCount ; i++) {
+        QThread* thread = QThread::create([&dispatcher, i, actionCount]() {
+            for (int seq = 0 ; seq < actionCount ; seq++) {
+                QVariantMap message;
+                message["producer"] = i;
+                message["seq"] = seq;
+                dispatcher.dispatchFromAnyThread("stress", message);
+            }
+        });
+        threads << thread;
+        thread->start();
+    }
+
+    QTRY_COMPARE_WITH_TIMEOUT(count, total, 60000);
+
+    foreach (QThread* thread, threads) {
+        thread->wait();
+        delete thread;
+    }
+
+    QVERIFY(inMainThread);
+    QVERIFY(inOrder);
+}
+
 void QuickFluxUnitTests::loading()
 {
     QFETCH(QString, input);
@@ -371,3 +1396,310 @@ void QuickFluxUnitTests::loading_data()
 
 }
 
+void QuickFluxUnitTests::benchmark_dispatch()
+{
+    SKIP_UNLESS_BENCHMARK();
+
+    QFETCH(int, listenerCount);
+    QFETCH(bool, filtered);
+
+    QQmlEngine engine;
+    QFDispatcher dispatcher;
+    dispatcher.setEngine(&engine);
+
+    int count = 0;
+
+    // Only two listeners are interested in the dispatched action.
+    for (int i = 0 ; i < listenerCount ; i++) {
+        QFListener* listener = new QFListener(&dispatcher);
+        bool interested = i == 0 || i == listenerCount - 1;
+
+        if (filtered) {
+            listener->setTypes(QStringList() << (interested ? QString("target") : QString("other%1").arg(i)));
+        }
+
+        connect(listener, &QFListener::dispatched, [&, interested](QString type) {
+            if (interested && type == "target") {
+                count++;
+            }
+        });
+
+        dispatcher.addListener(listener);
+    }
+
+    QBENCHMARK {
+        dispatcher.dispatch("target", QJSValue());
+    }
+
+    QVERIFY(count > 0);
+}
+
+void QuickFluxUnitTests::benchmark_dispatch_data()
+{
+    QTest::addColumn<int>("listenerCount");
+    QTest::addColumn<bool>("filtered");
+
+    QList<int> counts;
+    counts << 10 << 100 << 1000 << 5000;
+
+    foreach (int listenerCount, counts) {
+        QTest::newRow(QString("catchAll-%1").arg(listenerCount).toLocal8Bit().constData()) << listenerCount << false;
+        QTest::newRow(QString("filtered-%1").arg(listenerCount).toLocal8Bit().constData()) << listenerCount << true;
+    }
+}
+
+void QuickFluxUnitTests::benchmark_createListeners()
+{
+    SKIP_UNLESS_BENCHMARK();
+
+    QFETCH(int, listenerCount);
+
+    QQmlEngine engine;
+    QQmlComponent comp(&engine);
+
+    QString qml = QString("import QtQuick 2.0\n"
+                          "import QuickFlux 1.0\n"
+                          "Item { Repeater { model: %1; delegate: AppListener { filter: \"benchmark\" } } }").arg(listenerCount);
+
+    comp.setData(qml.toUtf8(), QUrl());
+    QVERIFY(!comp.isError());
+
+    QBENCHMARK {
+        QObject* object = comp.create();
+        QVERIFY(object);
+        delete object;
+    }
+}
+
+void QuickFluxUnitTests::benchmark_createListeners_data()
+{
+    QTest::addColumn<int>("listenerCount");
+
+    QTest::newRow("100") << 100;
+    QTest::newRow("1000") << 1000;
+    QTest::newRow("5000") << 5000;
+}
+
+void QuickFluxUnitTests::benchmark_storeFilterFunctions()
+{
+    SKIP_UNLESS_BENCHMARK();
+
+    const int storeCount = 50;
+
+    QQmlEngine engine;
+    QQmlComponent comp(&engine);
+
+    comp.setData("import QtQuick 2.0\n"
+                 "import QuickFlux 1.1\n"
+                 "Store {\n"
+                 "  filterFunctionEnabled: true\n"
+                 "  property int count: 0\n"
+                 "  function target(message) { count++; }\n"
+                 "}\n", QUrl());
+    QVERIFY(!comp.isError());
+
+    QScopedPointer<QObject> root(comp.create());
+    QVERIFY(root.data());
+
+    QQmlListReference children(root.data(), "children");
+    QVERIFY(children.canAppend());
+
+    for (int i = 1 ; i < storeCount ; i++) {
+        QObject* store = comp.create();
+        QVERIFY(store);
+        store->setParent(root.data());
+        children.append(store);
+    }
+
+    QBENCHMARK {
+        QMetaObject::invokeMethod(root.data(), "dispatch", Q_ARG(QString, "target"), Q_ARG(QJSValue, QJSValue()));
+        QMetaObject::invokeMethod(root.data(), "dispatch", Q_ARG(QString, "other"), Q_ARG(QJSValue, QJSValue()));
+    }
+
+    QVERIFY(root->property("count").toInt() > 0);
+    QCOMPARE(children.at(storeCount - 2)->property("count").toInt(), root->property("count").toInt());
+}
+
+void QuickFluxUnitTests::benchmark_dispatchLargePayload()
+{
+    SKIP_UNLESS_BENCHMARK();
+
+    QFETCH(bool, scriptListener);
+
+    QQmlEngine engine;
+    QFDispatcher dispatcher;
+    dispatcher.setEngine(&engine);
+
+    // About 1 MB of strings
+    QVariantList items;
+    for (int i = 0 ; i < 1024 ; i++) {
+        QVariantMap item;
+        item["id"] = i;
+        item["text"] = QString(512, QChar('a' + i % 26));
+        items << item;
+    }
+
+    QVariantMap payload;
+    payload["items"] = items;
+
+    int count = 0;
+
+    QFSubscription subscription = dispatcher.subscribe("benchmark", [&count](const QVariant &message) {
+        if (message.toMap()["items"].toList().size() == 1024) {
+            count++;
+        }
+    });
+
+    if (scriptListener) {
+        QFListener* listener = new QFListener(&dispatcher);
+        listener->setTypes(QStringList() << "benchmark");
+        dispatcher.addListener(listener);
+    }
+
+    QBENCHMARK {
+        dispatcher.dispatch("benchmark", QVariant(payload));
+    }
+
+    QVERIFY(count > 0);
+}
+
+void QuickFluxUnitTests::benchmark_dispatchLargePayload_data()
+{
+    QTest::addColumn<bool>("scriptListener");
+
+    QTest::newRow("nativeOnly") << false;
+    QTest::newRow("scriptListener") << true;
+}
+
+void QuickFluxUnitTests::benchmark_middlewareChain()
+{
+    SKIP_UNLESS_BENCHMARK();
+
+    QFETCH(int, depth);
+
+    QString middlewares;
+    for (int i = 0 ; i < depth ; i++) {
+        middlewares += "  Middleware { function dispatch(type, message) { next(type, message); } }\n";
+    }
+
+    QString qml = QString("import QtQuick 2.0\n"
+                          "import QuickFlux 1.1\n"
+                          "Item {\n"
+                          "  property alias dispatcher: dispatcher\n"
+                          "  Dispatcher { id: dispatcher }\n"
+                          "  MiddlewareList {\n"
+                          "  applyTarget: dispatcher\n"
+                          "%1"
+                          "  }\n"
+                          "}\n").arg(middlewares);
+
+    QQmlEngine engine;
+    QQmlComponent comp(&engine);
+    comp.setData(qml.toUtf8(), QUrl());
+    QVERIFY(!comp.isError());
+
+    QScopedPointer<QObject> root(comp.create());
+    QVERIFY(root.data());
+
+    QFDispatcher* dispatcher = qobject_cast<QFDispatcher*>(root->property("dispatcher").value<QObject*>());
+    QVERIFY(dispatcher);
+
+    int count = 0;
+    QFSubscription subscription = dispatcher->subscribe("benchmark", [&count](const QVariant &message) {
+        Q_UNUSED(message);
+        count++;
+    });
+
+    QBENCHMARK {
+        dispatcher->dispatch("benchmark", QVariant(1));
+    }
+
+    QVERIFY(count > 0);
+}
+
+void QuickFluxUnitTests::benchmark_middlewareChain_data()
+{
+    QTest::addColumn<int>("depth");
+
+    QList<int> depths;
+    depths << 1 << 2 << 4 << 8 << 16 << 32;
+
+    foreach (int depth, depths) {
+        QTest::newRow(QString::number(depth).toLocal8Bit().constData()) << depth;
+    }
+}
+
+void QuickFluxUnitTests::benchmark_dispatchFromAnyThread()
+{
+    SKIP_UNLESS_BENCHMARK();
+
+    QFETCH(QString, metric);
+
+    QQmlEngine engine;
+    QFDispatcher dispatcher;
+    dispatcher.setEngine(&engine);
+
+    const int producerCount = 8;
+    const int actionCount = 20000;
+    const int total = producerCount * actionCount;
+
+    QElapsedTimer timer;
+    int count = 0;
+    qint64 totalLatency = 0;
+
+    connect(&dispatcher, &QFDispatcher::dispatched, [&](QString type, QJSValue message) {
+        Q_UNUSED(type);
+        totalLatency += timer.nsecsElapsed() - message.property("sentAt").toVariant().toLongLong();
+        count++;
+    });
+
+    // Dispatch the actions from the producer threads, and wait until all of them are delivered
+    auto run = [&]() {
+        QList<QThread*> threads;
+        count = 0;
+        totalLatency = 0;
+
+        for (int i = 0 ; i < producerCount ; i++) {
+            QThread* thread = QThread::create([&dispatcher, &timer, actionCount]() {
+                for (int seq = 0 ; seq < actionCount ; seq++) {
+                    QVariantMap message;
+                    message["sentAt"] = timer.nsecsElapsed();
+                    dispatcher.dispatchFromAnyThread("stress", message);
+                }
+            });
+            threads << thread;
+            thread->start();
+        }
+
+        while (count < total) {
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        }
+
+        foreach (QThread* thread, threads) {
+            thread->wait();
+            delete thread;
+        }
+    };
+
+    timer.start();
+
+    if (metric == "throughput") {
+        QBENCHMARK {
+            run();
+        }
+    } else {
+        // Average time from dispatchFromAnyThread() to the delivery
+        run();
+        QTest::setBenchmarkResult(totalLatency / double(total) / 1e6, QTest::WalltimeMilliseconds);
+    }
+
+    QCOMPARE(count, total);
+}
+
+void QuickFluxUnitTests::benchmark_dispatchFromAnyThread_data()
+{
+    QTest::addColumn<QString>("metric");
+
+    QTest::newRow("throughput") << QString("throughput");
+    QTest::newRow("latency") << QString("latency");
+}
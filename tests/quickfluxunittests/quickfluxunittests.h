@@ -21,6 +21,8 @@ private Q_SLOTS:
 
     void singletonObject();
 
+    void singletonObject_cache();
+
     void signalProxy();
 
     void dispatch_qvariant();
@@ -33,9 +35,58 @@ private Q_SLOTS:
 
     void dispatcherHook();
 
+    void actionTypeRegistry();
+
+    void appScriptSignalConditionTypes();
+
+    void actionTypePatterns();
+
+    void dispatchFromAnyThread();
+
+    void coalescing();
+
+    void batchedDispatch();
+
+    void priorityLanes();
+
+    void ringBuffer();
+
+    void listenerSlotReuse();
+
+    void waitForSchedule();
+
+    void subscribe();
+
+    void nativeMiddleware();
+
+    void nativeMiddleware_async();
+
+    void profiler();
+
+    void profiler_trace();
+
+    void dispatch_allocations();
+
     void loading();
     void loading_data();
 
+    void benchmark_dispatch();
+    void benchmark_dispatch_data();
+
+    void benchmark_createListeners();
+    void benchmark_createListeners_data();
+
+    void benchmark_storeFilterFunctions();
+
+    void benchmark_dispatchLargePayload();
+    void benchmark_dispatchLargePayload_data();
+
+    void benchmark_middlewareChain();
+    void benchmark_middlewareChain_data();
+
+    void benchmark_dispatchFromAnyThread();
+    void benchmark_dispatchFromAnyThread_data();
+
 };
 
 #endif // QUICKFLUXUNITTESTS_H
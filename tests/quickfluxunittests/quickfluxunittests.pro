@@ -15,7 +15,8 @@ SOURCES += main.cpp \
     quickfluxunittests.cpp \
     testenv.cpp \
     actiontypes.cpp \
-    messagelogger.cpp
+    messagelogger.cpp \
+    allocationcounter.cpp
 
 include(vendor/vendor.pri)
 include(../../quickflux.pri)
@@ -24,7 +25,8 @@ HEADERS += \
     quickfluxunittests.h \
     testenv.h \
     actiontypes.h \
-    messagelogger.h
+    messagelogger.h \
+    allocationcounter.h
 
 RESOURCES += \
     qml.qrc
@@ -37,6 +39,7 @@ RESOURCES += \
 DISTFILES += \
     qmltests/tst_appdispatcher_dispatch_reentrant.qml \
     qmltests/tst_appdispatcher_waitfor.qml \
+    qmltests/tst_appdispatcher_routing.qml \
     qmltests/tst_appdispatcher.qml \
     qmltests/tst_applistener_alwayson.qml \
     qmltests/tst_applistener_filter.qml \
@@ -58,4 +61,14 @@ DISTFILES += \
     qmltests/tst_middlewarelist.qml \
     qmltests/tst_middlewarelist_applyTarget.qml \
     ../../appveyor.yml \
-    qmltests/tst_middleware_exception.qml
+    qmltests/tst_middleware_exception.qml \
+    qmltests/tst_profiler.qml \
+    qmltests/tst_middleware_types.qml \
+    qmltests/tst_middleware_async.qml \
+    qmltests/tst_middleware_ratelimit.qml \
+    qmltests/tst_store_filters.qml \
+    qmltests/tst_store_summary.qml \
+    qmltests/tst_store_cycle.qml \
+    qmltests/tst_filter_patterns.qml \
+    qmltests/tst_filter_predicate.qml \
+    qmltests/tst_store_batch.qml